@@ -0,0 +1,272 @@
+#include "AABBTree.h"
+#include <algorithm>
+
+using namespace NCL;
+using namespace CSC8503;
+
+AABBTree::AABBTree(float margin) {
+	this->margin = margin;
+	Clear();
+}
+
+AABBTree::~AABBTree() {
+}
+
+void AABBTree::Clear() {
+	nodes.clear();
+	root		= -1;
+	freeList	= -1;
+}
+
+int AABBTree::AllocateNode() {
+	int index;
+	if (freeList != -1) {
+		index		= freeList;
+		freeList	= nodes[index].parent;
+	}
+	else {
+		index = (int)nodes.size();
+		nodes.emplace_back();
+	}
+	TreeNode& n = nodes[index];
+	n.object	= nullptr;
+	n.parent	= -1;
+	n.left		= -1;
+	n.right		= -1;
+	n.height	= 0;
+	return index;
+}
+
+void AABBTree::FreeNode(int node) {
+	nodes[node].parent	= freeList;
+	nodes[node].height	= -1;
+	nodes[node].object	= nullptr;
+	freeList = node;
+}
+
+int AABBTree::CreateProxy(const BoundingBox& box, GameObject* object) {
+	int proxy = AllocateNode();
+
+	Vector3 fatten(margin, margin, margin);
+	nodes[proxy].box.min	= box.min - fatten;
+	nodes[proxy].box.max	= box.max + fatten;
+	nodes[proxy].object		= object;
+
+	InsertLeaf(proxy);
+	return proxy;
+}
+
+void AABBTree::DestroyProxy(int proxy) {
+	RemoveLeaf(proxy);
+	FreeNode(proxy);
+}
+
+/*
+If the object is still inside its fat AABB, the tree doesn't need to change.
+Otherwise the leaf is pulled out, and put back in with a new fat AABB around
+its current position. Returns whether the tree was modified.
+*/
+bool AABBTree::MoveProxy(int proxy, const BoundingBox& box) {
+	if (nodes[proxy].box.Contains(box)) {
+		return false;
+	}
+	RemoveLeaf(proxy);
+
+	Vector3 fatten(margin, margin, margin);
+	nodes[proxy].box.min = box.min - fatten;
+	nodes[proxy].box.max = box.max + fatten;
+
+	InsertLeaf(proxy);
+	return true;
+}
+
+/*
+New leaves are paired up with whichever existing node results in the smallest
+increase in surface area across the tree. We descend from the root, and stop
+as soon as creating a new parent here is cheaper than pushing the leaf down
+into either child.
+*/
+void AABBTree::InsertLeaf(int leaf) {
+	if (root == -1) {
+		root = leaf;
+		nodes[root].parent = -1;
+		return;
+	}
+
+	BoundingBox leafBox = nodes[leaf].box;
+	int index = root;
+	while (!nodes[index].IsLeaf()) {
+		int left	= nodes[index].left;
+		int right	= nodes[index].right;
+
+		float area			= nodes[index].box.SurfaceArea();
+		float combinedArea	= BoundingBox::Union(nodes[index].box, leafBox).SurfaceArea();
+
+		//Cost of creating a new parent for this node and the new leaf
+		float cost = 2.0f * combinedArea;
+
+		//Minimum cost of pushing the leaf further down the tree
+		float inheritanceCost = 2.0f * (combinedArea - area);
+
+		auto descendCost = [&](int child) {
+			float newArea = BoundingBox::Union(leafBox, nodes[child].box).SurfaceArea();
+			if (nodes[child].IsLeaf()) {
+				return newArea + inheritanceCost;
+			}
+			return (newArea - nodes[child].box.SurfaceArea()) + inheritanceCost;
+		};
+
+		float leftCost	= descendCost(left);
+		float rightCost	= descendCost(right);
+
+		if (cost < leftCost && cost < rightCost) {
+			break;
+		}
+		index = leftCost < rightCost ? left : right;
+	}
+
+	int sibling		= index;
+	int oldParent	= nodes[sibling].parent;
+	int newParent	= AllocateNode();
+
+	nodes[newParent].parent = oldParent;
+	nodes[newParent].box	= BoundingBox::Union(leafBox, nodes[sibling].box);
+	nodes[newParent].height	= nodes[sibling].height + 1;
+	nodes[newParent].left	= sibling;
+	nodes[newParent].right	= leaf;
+	nodes[sibling].parent	= newParent;
+	nodes[leaf].parent		= newParent;
+
+	if (oldParent != -1) {
+		if (nodes[oldParent].left == sibling) {
+			nodes[oldParent].left = newParent;
+		}
+		else {
+			nodes[oldParent].right = newParent;
+		}
+	}
+	else {
+		root = newParent;
+	}
+	Refit(nodes[leaf].parent);
+}
+
+void AABBTree::RemoveLeaf(int leaf) {
+	if (leaf == root) {
+		root = -1;
+		return;
+	}
+
+	int parent		= nodes[leaf].parent;
+	int grandParent = nodes[parent].parent;
+	int sibling		= nodes[parent].left == leaf ? nodes[parent].right : nodes[parent].left;
+
+	if (grandParent != -1) {
+		if (nodes[grandParent].left == parent) {
+			nodes[grandParent].left = sibling;
+		}
+		else {
+			nodes[grandParent].right = sibling;
+		}
+		nodes[sibling].parent = grandParent;
+		FreeNode(parent);
+		Refit(grandParent);
+	}
+	else {
+		root = sibling;
+		nodes[sibling].parent = -1;
+		FreeNode(parent);
+	}
+	nodes[leaf].parent = -1;
+}
+
+//Walks back up to the root, rebalancing and recalculating bounds as it goes
+void AABBTree::Refit(int node) {
+	int index = node;
+	while (index != -1) {
+		index = Balance(index);
+
+		int left	= nodes[index].left;
+		int right	= nodes[index].right;
+
+		nodes[index].height = 1 + std::max(nodes[left].height, nodes[right].height);
+		nodes[index].box	= BoundingBox::Union(nodes[left].box, nodes[right].box);
+
+		index = nodes[index].parent;
+	}
+}
+
+/*
+If one side of node A is more than one level taller than the other, the
+taller child is rotated up to take A's place. Returns the index of the node
+that now sits where A used to be.
+
+		A			  C
+	   / \			 / \
+	  B   C   ->	A   F
+		 / \	   / \
+		F   G	  B   G
+*/
+int AABBTree::Balance(int iA) {
+	if (nodes[iA].IsLeaf() || nodes[iA].height < 2) {
+		return iA;
+	}
+
+	int iB = nodes[iA].left;
+	int iC = nodes[iA].right;
+
+	int balance = nodes[iC].height - nodes[iB].height;
+
+	if (balance > 1) {
+		return Rotate(iA, iC, iB, true);
+	}
+	if (balance < -1) {
+		return Rotate(iA, iB, iC, false);
+	}
+	return iA;
+}
+
+int AABBTree::Rotate(int iA, int iUp, int iStay, bool upWasRight) {
+	TreeNode& A		= nodes[iA];
+	TreeNode& Up	= nodes[iUp];
+
+	int iF = Up.left;
+	int iG = Up.right;
+
+	//Up takes A's place
+	Up.left		= iA;
+	Up.parent	= A.parent;
+	A.parent	= iUp;
+
+	if (Up.parent != -1) {
+		if (nodes[Up.parent].left == iA) {
+			nodes[Up.parent].left = iUp;
+		}
+		else {
+			nodes[Up.parent].right = iUp;
+		}
+	}
+	else {
+		root = iUp;
+	}
+
+	//The taller of Up's children stays with Up, the other goes to A
+	int iTall	= nodes[iF].height > nodes[iG].height ? iF : iG;
+	int iShort	= iTall == iF ? iG : iF;
+
+	Up.right = iTall;
+	if (upWasRight) {
+		A.right = iShort;
+	}
+	else {
+		A.left = iShort;
+	}
+	nodes[iShort].parent = iA;
+
+	A.box	= BoundingBox::Union(nodes[iStay].box, nodes[iShort].box);
+	Up.box	= BoundingBox::Union(A.box, nodes[iTall].box);
+
+	A.height	= 1 + std::max(nodes[iStay].height, nodes[iShort].height);
+	Up.height	= 1 + std::max(A.height, nodes[iTall].height);
+	return iUp;
+}
@@ -0,0 +1,146 @@
+#pragma once
+#include "../../Common/Vector3.h"
+#include <vector>
+
+namespace NCL {
+	using namespace NCL::Maths;
+	namespace CSC8503 {
+		class GameObject;
+
+		struct BoundingBox {
+			Vector3 min;
+			Vector3 max;
+
+			BoundingBox() {}
+			BoundingBox(const Vector3& position, const Vector3& halfSize) {
+				min = position - halfSize;
+				max = position + halfSize;
+			}
+
+			bool Overlaps(const BoundingBox& other) const {
+				return	min.x < other.max.x && max.x > other.min.x &&
+						min.y < other.max.y && max.y > other.min.y &&
+						min.z < other.max.z && max.z > other.min.z;
+			}
+
+			bool Contains(const BoundingBox& other) const {
+				return	min.x <= other.min.x && min.y <= other.min.y && min.z <= other.min.z &&
+						max.x >= other.max.x && max.y >= other.max.y && max.z >= other.max.z;
+			}
+
+			float SurfaceArea() const {
+				Vector3 d = max - min;
+				return 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+			}
+
+			static BoundingBox Union(const BoundingBox& a, const BoundingBox& b) {
+				BoundingBox box;
+				for (int i = 0; i < 3; ++i) {
+					box.min[i] = a.min[i] < b.min[i] ? a.min[i] : b.min[i];
+					box.max[i] = a.max[i] > b.max[i] ? a.max[i] : b.max[i];
+				}
+				return box;
+			}
+		};
+
+		/*
+		A dynamic bounding volume hierarchy, in the style of Box2D's b2DynamicTree,
+		but in 3D. Each leaf stores a 'fat' AABB, which is slightly larger than the
+		object it holds, so that small movements don't require the tree to change
+		at all. When an object does escape its fat AABB, its leaf is removed and
+		reinserted, and the tree is refit and rebalanced with AVL style rotations
+		on the way back up to the root.
+		*/
+		class AABBTree	{
+		public:
+			AABBTree(float margin = 0.5f);
+			~AABBTree();
+
+			void Clear();
+
+			int		CreateProxy(const BoundingBox& box, GameObject* object);
+			void	DestroyProxy(int proxy);
+			bool	MoveProxy(int proxy, const BoundingBox& box);
+
+			GameObject* GetObject(int proxy) const {
+				return nodes[proxy].object;
+			}
+
+			//Free nodes and internal nodes don't hold an object
+			bool IsProxy(int proxy) const {
+				return nodes[proxy].object != nullptr;
+			}
+
+			const BoundingBox& GetFatBox(int proxy) const {
+				return nodes[proxy].box;
+			}
+
+			int GetHeight() const {
+				return root == -1 ? 0 : nodes[root].height;
+			}
+
+			int GetRoot() const {
+				return root;
+			}
+
+			//Calls func(proxy) for every leaf whose fat AABB overlaps the box.
+			//Returning false from func stops the query early.
+			template<class T>
+			void Query(const BoundingBox& box, T func) const {
+				if (root == -1) {
+					return;
+				}
+				queryStack.clear();
+				queryStack.emplace_back(root);
+
+				while (!queryStack.empty()) {
+					int index = queryStack.back();
+					queryStack.pop_back();
+
+					const TreeNode& n = nodes[index];
+					if (!n.box.Overlaps(box)) {
+						continue;
+					}
+					if (n.IsLeaf()) {
+						if (!func(index)) {
+							return;
+						}
+					}
+					else {
+						queryStack.emplace_back(n.left);
+						queryStack.emplace_back(n.right);
+					}
+				}
+			}
+
+		protected:
+			struct TreeNode {
+				BoundingBox box;
+				GameObject* object;
+				int			parent; //doubles as the next free node when unused
+				int			left;
+				int			right;
+				int			height; //leaves have a height of 0, free nodes -1
+
+				bool IsLeaf() const {
+					return left == -1;
+				}
+			};
+
+			int		AllocateNode();
+			void	FreeNode(int node);
+
+			void	InsertLeaf(int leaf);
+			void	RemoveLeaf(int leaf);
+			void	Refit(int node);
+			int		Balance(int node);
+			int		Rotate(int node, int up, int stay, bool upWasRight);
+
+			std::vector<TreeNode>	nodes;
+			mutable std::vector<int> queryStack;
+			int		root;
+			int		freeList;
+			float	margin;
+		};
+	}
+}
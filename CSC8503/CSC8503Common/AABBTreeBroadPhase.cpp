@@ -0,0 +1,95 @@
+#include "AABBTreeBroadPhase.h"
+#include "GameObject.h"
+#include <algorithm>
+
+using namespace NCL;
+using namespace CSC8503;
+
+AABBTreeBroadPhase::AABBTreeBroadPhase(float margin) : tree(margin) {
+}
+
+AABBTreeBroadPhase::~AABBTreeBroadPhase() {
+}
+
+void AABBTreeBroadPhase::ClearProxies() {
+	tree.Clear();
+	tightBoxes.clear();
+	moveBuffer.clear();
+	pairCache.clear();
+}
+
+int AABBTreeBroadPhase::AddProxy(GameObject* object, const Vector3& position, const Vector3& halfSize) {
+	BoundingBox box(position, halfSize);
+	int proxy = tree.CreateProxy(box, object);
+
+	if (proxy >= (int)tightBoxes.size()) {
+		tightBoxes.resize(proxy + 1);
+	}
+	tightBoxes[proxy] = box;
+	moveBuffer.emplace_back(proxy);
+	return proxy;
+}
+
+void AABBTreeBroadPhase::MoveProxy(int handle, const Vector3& position, const Vector3& halfSize) {
+	tightBoxes[handle] = BoundingBox(position, halfSize);
+	if (tree.MoveProxy(handle, tightBoxes[handle])) {
+		moveBuffer.emplace_back(handle);
+	}
+}
+
+/*
+Any cached pairs using this proxy are left alone for now, they'll fail the
+validity check the next time pairs are found, and get removed then.
+*/
+void AABBTreeBroadPhase::RemoveProxy(int handle) {
+	tree.DestroyProxy(handle);
+	auto found = std::find(moveBuffer.begin(), moveBuffer.end(), handle);
+	if (found != moveBuffer.end()) {
+		*found = moveBuffer.back();
+		moveBuffer.pop_back();
+	}
+}
+
+//Both proxies must still be live leaves, with their fat AABBs overlapping
+bool AABBTreeBroadPhase::IsValidPair(int a, int b) const {
+	if (!tree.IsProxy(a) || !tree.IsProxy(b)) {
+		return false;
+	}
+	return tree.GetFatBox(a).Overlaps(tree.GetFatBox(b));
+}
+
+/*
+The cached pairs are first checked to see if their fat AABBs still overlap,
+then the tree is queried for every proxy that has been reinserted since the
+last update, to pick up any new pairs. The fat AABBs in the tree can overlap
+when the objects themselves don't, so the tight boxes are tested before a
+pair is passed on to the narrowphase.
+*/
+void AABBTreeBroadPhase::FindPairs(PairBuffer& pairs) {
+	pairCache.erase(std::remove_if(pairCache.begin(), pairCache.end(), [&](const std::pair<int, int>& p) {
+		return !IsValidPair(p.first, p.second);
+	}), pairCache.end());
+
+	size_t cachedCount = pairCache.size();
+	for (int proxy : moveBuffer) {
+		tree.Query(tree.GetFatBox(proxy), [&](int other) {
+			if (other != proxy && CanCollide(tree.GetObject(proxy), tree.GetObject(other))) {
+				pairCache.emplace_back(proxy < other ? proxy : other, proxy < other ? other : proxy);
+			}
+			return true;
+		});
+	}
+	moveBuffer.clear();
+
+	//Two moved proxies will both find each other, and may have been cached already
+	if (pairCache.size() > cachedCount) {
+		std::sort(pairCache.begin(), pairCache.end());
+		pairCache.erase(std::unique(pairCache.begin(), pairCache.end()), pairCache.end());
+	}
+
+	for (const std::pair<int, int>& p : pairCache) {
+		if (tightBoxes[p.first].Overlaps(tightBoxes[p.second])) {
+			pairs.Add(tree.GetObject(p.first), tree.GetObject(p.second));
+		}
+	}
+}
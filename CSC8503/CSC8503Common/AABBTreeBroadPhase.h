@@ -0,0 +1,41 @@
+#pragma once
+#include "BroadPhaseStructure.h"
+#include "AABBTree.h"
+#include <vector>
+
+namespace NCL {
+	namespace CSC8503 {
+		/*
+		A broadphase built on a dynamic AABB tree. Unlike the QuadTree, this
+		works in all 3 axes, and every object is stored exactly once, so each
+		potentially colliding pair is only found a single time.
+
+		Pairs of overlapping fat AABBs are kept between updates, so the tree
+		only needs to be queried for proxies that have been reinserted.
+		*/
+		class AABBTreeBroadPhase : public BroadPhaseStructure	{
+		public:
+			AABBTreeBroadPhase(float margin = 0.5f);
+			~AABBTreeBroadPhase();
+
+			void FindPairs(PairBuffer& pairs) override;
+
+			int GetTreeHeight() const {
+				return tree.GetHeight();
+			}
+
+		protected:
+			void	ClearProxies() override;
+			int		AddProxy(GameObject* object, const Vector3& position, const Vector3& halfSize) override;
+			void	MoveProxy(int handle, const Vector3& position, const Vector3& halfSize) override;
+			void	RemoveProxy(int handle) override;
+
+			bool	IsValidPair(int a, int b) const;
+
+			AABBTree tree;
+			std::vector<BoundingBox>	tightBoxes; //indexed by tree proxy
+			std::vector<int>			moveBuffer;
+			std::vector<std::pair<int, int>> pairCache;
+		};
+	}
+}
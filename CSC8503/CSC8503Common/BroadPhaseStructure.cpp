@@ -0,0 +1,143 @@
+#include "BroadPhaseStructure.h"
+#include "GameObject.h"
+
+using namespace NCL;
+using namespace CSC8503;
+
+void BroadPhaseStructure::Clear() {
+	ClearProxies();
+	proxies.clear();
+	staticTree.Clear();
+	staticsChanged = false;
+}
+
+namespace {
+	bool IsStaticObject(const GameObject* object) {
+		const PhysicsObject* physics = object->GetPhysicsObject();
+		return physics && physics->GetBodyType() == BodyType::Static;
+	}
+}
+
+/*
+Every collideable object in the world gets a proxy the first time it is seen.
+After that, the proxy is only moved if the object's broadphase AABB changed,
+so resting or static objects cost nothing more than a comparison. Any proxy
+that wasn't seen this update belongs to an object that has left the world.
+
+Static bodies never move, so they don't even get the comparison. An object
+whose body type has changed is taken out and added again as its new type.
+*/
+void BroadPhaseStructure::UpdateProxies(GameObjectIterator first, GameObjectIterator last) {
+	updateCount++;
+
+	for (auto i = first; i != last; ++i) {
+		if (!(*i)->GetBoundingVolume()) {
+			continue;
+		}
+		bool isStatic = IsStaticObject(*i);
+
+		auto found = proxies.find((*i)->GetWorldID());
+		if (found != proxies.end() && found->second.isStatic != isStatic) {
+			RemoveRecord(found->second);
+			proxies.erase(found);
+			found = proxies.end();
+		}
+		if (found == proxies.end()) {
+			AddRecord(*i, isStatic);
+			continue;
+		}
+
+		ProxyRecord& record = found->second;
+		record.lastSeen = updateCount;
+		if (record.isStatic) {
+			continue;
+		}
+
+		Vector3 halfSize;
+		(*i)->GetBroadphaseAABB(halfSize);
+		Vector3 position = (*i)->GetTransform().GetPosition();
+
+		if (record.position == position && record.halfSize == halfSize) {
+			continue;
+		}
+		record.position = position;
+		record.halfSize = halfSize;
+		MoveProxy(record.handle, position, halfSize);
+		FindStaticOverlaps(record);
+	}
+
+	for (auto i = proxies.begin(); i != proxies.end(); ) {
+		if (i->second.lastSeen != updateCount) {
+			RemoveRecord(i->second);
+			i = proxies.erase(i);
+		}
+		else {
+			++i;
+		}
+	}
+
+	//A static body was added or removed, which could change what anything overlaps
+	if (staticsChanged) {
+		for (auto& i : proxies) {
+			if (!i.second.isStatic) {
+				FindStaticOverlaps(i.second);
+			}
+		}
+		staticsChanged = false;
+	}
+}
+
+/*
+Static bodies are skipped when the world's AABBs are updated, so theirs is
+worked out here instead, the one time it's needed.
+*/
+void BroadPhaseStructure::AddRecord(GameObject* object, bool isStatic) {
+	if (isStatic) {
+		object->UpdateBroadphaseAABB();
+	}
+	ProxyRecord record;
+	record.object	= object;
+	record.position = object->GetTransform().GetPosition();
+	object->GetBroadphaseAABB(record.halfSize);
+	record.lastSeen = updateCount;
+	record.isStatic = isStatic;
+
+	if (isStatic) {
+		record.handle	= staticTree.CreateProxy(BoundingBox(record.position, record.halfSize), object);
+		staticsChanged	= true;
+	}
+	else {
+		record.handle = AddProxy(object, record.position, record.halfSize);
+		FindStaticOverlaps(record);
+	}
+	proxies.insert({ object->GetWorldID(), record });
+}
+
+void BroadPhaseStructure::RemoveRecord(const ProxyRecord& record) {
+	if (record.isStatic) {
+		staticTree.DestroyProxy(record.handle);
+		staticsChanged = true;
+	}
+	else {
+		RemoveProxy(record.handle);
+	}
+}
+
+void BroadPhaseStructure::FindStaticOverlaps(ProxyRecord& record) const {
+	record.staticOverlaps.clear();
+	staticTree.Query(BoundingBox(record.position, record.halfSize), [&](int proxy) {
+		GameObject* other = staticTree.GetObject(proxy);
+		if (CanCollide(record.object, other)) {
+			record.staticOverlaps.emplace_back(other);
+		}
+		return true;
+	});
+}
+
+void BroadPhaseStructure::FindStaticPairs(PairBuffer& pairs) const {
+	for (const auto& i : proxies) {
+		for (GameObject* other : i.second.staticOverlaps) {
+			pairs.Add(i.second.object, other);
+		}
+	}
+}
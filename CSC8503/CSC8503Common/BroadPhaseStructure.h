@@ -0,0 +1,88 @@
+#pragma once
+#include "CollisionDetection.h"
+#include "GameWorld.h"
+#include "PairBuffer.h"
+#include "AABBTree.h"
+#include <unordered_map>
+
+namespace NCL {
+	namespace CSC8503 {
+		enum class BroadPhaseType {
+			QuadTree,
+			AABBTree,
+			SweepAndPrune,
+			HashGrid,
+			MAX_BROADPHASE_TYPE
+		};
+
+		/*
+		A broadphase that persists between physics substeps. It keeps a proxy
+		for every collideable object, and only touches the proxies of objects
+		whose broadphase AABB has actually changed since the last update.
+
+		Static bodies don't get a proxy in the structure itself. They go into
+		a separate tree of their own the first time they're seen, which is
+		never touched again unless one of them is removed. Every other proxy
+		remembers which static bodies it overlaps, and only asks the tree
+		again when it moves, so a level full of floors and walls costs nothing
+		per update, and never gets swept, sorted or rebalanced along with the
+		objects moving around in it.
+		*/
+		class BroadPhaseStructure	{
+		public:
+			BroadPhaseStructure() : staticTree(0.0f) {
+				updateCount		= 0;
+				staticsChanged	= false;
+			}
+			virtual ~BroadPhaseStructure() {}
+
+			void Clear();
+
+			void UpdateProxies(GameObjectIterator first, GameObjectIterator last);
+
+			//Incremental structures keep the buffer passed to FindPairs up to date
+			//themselves, so it shouldn't be cleared or sorted between updates
+			virtual bool IsIncremental() const {
+				return false;
+			}
+
+			//Pairs between moving objects, which don't include anything static
+			virtual void FindPairs(PairBuffer& pairs) = 0;
+
+			//Pairs between moving objects and static ones, which are added to the buffer unsorted
+			void FindStaticPairs(PairBuffer& pairs) const;
+
+			//Includes the static bodies
+			int GetProxyCount() const {
+				return (int)proxies.size();
+			}
+
+		protected:
+			struct ProxyRecord {
+				GameObject* object;
+				Vector3		position;
+				Vector3		halfSize;
+				int			handle;		//into the static tree for static bodies, the structure for everything else
+				int			lastSeen;
+				bool		isStatic;
+				std::vector<GameObject*> staticOverlaps;	//the static bodies a moving proxy's AABB overlaps
+			};
+
+			virtual void	ClearProxies() = 0;
+			void			AddRecord(GameObject* object, bool isStatic);
+			void			RemoveRecord(const ProxyRecord& record);
+			void			FindStaticOverlaps(ProxyRecord& record) const;
+
+			virtual int		AddProxy(GameObject* object, const Vector3& position, const Vector3& halfSize) = 0;
+			virtual void	MoveProxy(int handle, const Vector3& position, const Vector3& halfSize) = 0;
+			virtual void	RemoveProxy(int handle) = 0;
+
+			std::unordered_map<int, ProxyRecord> proxies; //keyed by world ID
+			int updateCount;
+
+			AABBTree	staticTree;
+			bool		staticsChanged; //every moving proxy needs its static overlaps finding again
+
+		};
+	}
+}
@@ -0,0 +1,268 @@
+#include "ChainSolver.h"
+#include "ConstraintSolver.h"
+#include <algorithm>
+
+using namespace NCL;
+using namespace CSC8503;
+
+namespace {
+	//Pivots that have lost this much of what they started with mean the links are nearly dependent
+	const float minimumPivot = 1e-5f;
+
+	/*
+	Each link's own term is made a little bigger than it should be. A chain
+	pulled tight in a straight line has more links pulling along the line
+	than its bodies have ways to move along it, so it has no solution at
+	all without this. With it, the impulses the bodies can't respond to
+	stay finite, and everything else only becomes very slightly softer.
+	*/
+	const float regularisation = 1e-4f;
+}
+
+ChainSolver::ChainSolver() {
+}
+
+ChainSolver::~ChainSolver() {
+}
+
+void ChainSolver::Clear() {
+	links.clear();
+	nodes.clear();
+	nodeLinks.clear();
+	factors.clear();
+	pivots.clear();
+}
+
+void ChainSolver::AddLink(int bodyA, int bodyB, const Vector3& normal,
+	const Vector3& angularA, const Vector3& angularB, const Vector3& inertiaA, const Vector3& inertiaB) {
+	Link link;
+	link.bodyA		= bodyA;
+	link.bodyB		= bodyB;
+	link.normal		= normal;
+	link.angularA	= angularA;
+	link.angularB	= angularB;
+	link.inertiaA	= inertiaA;
+	link.inertiaB	= inertiaB;
+	links.emplace_back(link);
+}
+
+int ChainSolver::TreeIndex(int body) const {
+	return (int)(std::lower_bound(treeBodies.begin(), treeBodies.end(), body) - treeBodies.begin());
+}
+
+/*
+How much an impulse on one link changes the velocity along another,
+through the body they share. Impulses push A backwards along the normal,
+and B forwards.
+*/
+float ChainSolver::Coupling(int body, int linkA, int linkB, float inverseMass) const {
+	const Link& a = links[linkA];
+	const Link& b = links[linkB];
+
+	bool sideA = a.bodyA == body;
+	bool sideB = b.bodyA == body;
+
+	float sign = sideA == sideB ? 1.0f : -1.0f;
+	const Vector3& angular = sideA ? a.angularA : a.angularB;
+	const Vector3& inertia = sideB ? b.inertiaA : b.inertiaB;
+
+	return sign * (inverseMass * Vector3::Dot(a.normal, b.normal) + Vector3::Dot(angular, inertia));
+}
+
+/*
+The moving bodies are found and put in order, then walked depth first
+from the lowest numbered body of each tree. Finding a body a second time
+means there's a loop, so we give up. Otherwise each body ends up after
+all of its children, which is the order they're eliminated in.
+*/
+bool ChainSolver::Factorise(const std::vector<SolverBody>& bodies) {
+	nodes.clear();
+	nodeLinks.clear();
+	factors.clear();
+
+	int linkCount = (int)links.size();
+
+	treeBodies.clear();
+	for (const Link& link : links) {
+		bool movesA = bodies[link.bodyA].inverseMass != 0.0f;
+		bool movesB = bodies[link.bodyB].inverseMass != 0.0f;
+		if ((!movesA && !movesB) || link.bodyA == link.bodyB) {
+			return false;
+		}
+		if (movesA) {
+			treeBodies.emplace_back(link.bodyA);
+		}
+		if (movesB) {
+			treeBodies.emplace_back(link.bodyB);
+		}
+	}
+	std::sort(treeBodies.begin(), treeBodies.end());
+	treeBodies.erase(std::unique(treeBodies.begin(), treeBodies.end()), treeBodies.end());
+	int bodyCount = (int)treeBodies.size();
+
+	adjacencyStarts.assign(bodyCount + 1, 0);
+	for (const Link& link : links) {
+		if (bodies[link.bodyA].inverseMass != 0.0f) {
+			adjacencyStarts[TreeIndex(link.bodyA) + 1]++;
+		}
+		if (bodies[link.bodyB].inverseMass != 0.0f) {
+			adjacencyStarts[TreeIndex(link.bodyB) + 1]++;
+		}
+	}
+	for (int i = 0; i < bodyCount; ++i) {
+		adjacencyStarts[i + 1] += adjacencyStarts[i];
+	}
+	adjacency.resize(adjacencyStarts[bodyCount]);
+	nextEdges.assign(adjacencyStarts.begin(), adjacencyStarts.end() - 1);
+	for (int i = 0; i < linkCount; ++i) {
+		if (bodies[links[i].bodyA].inverseMass != 0.0f) {
+			adjacency[nextEdges[TreeIndex(links[i].bodyA)]++] = i;
+		}
+		if (bodies[links[i].bodyB].inverseMass != 0.0f) {
+			adjacency[nextEdges[TreeIndex(links[i].bodyB)]++] = i;
+		}
+	}
+
+	const int unvisited = -2;
+	parentLinks.assign(bodyCount, unvisited);
+	nextEdges.assign(adjacencyStarts.begin(), adjacencyStarts.end() - 1);
+
+	for (int root = 0; root < bodyCount; ++root) {
+		if (parentLinks[root] != unvisited) {
+			continue;
+		}
+		parentLinks[root] = -1;
+		stack.emplace_back(root);
+
+		while (!stack.empty()) {
+			int current = stack.back();
+			if (nextEdges[current] == adjacencyStarts[current + 1]) {
+				stack.pop_back();
+
+				Node node;
+				node.body		= treeBodies[current];
+				node.parentLink = parentLinks[current];
+				node.firstLink	= (int)nodeLinks.size();
+				for (int i = adjacencyStarts[current]; i < adjacencyStarts[current + 1]; ++i) {
+					if (adjacency[i] != node.parentLink) {
+						nodeLinks.emplace_back(adjacency[i]);
+					}
+				}
+				if (node.parentLink != -1) {
+					nodeLinks.emplace_back(node.parentLink);
+				}
+				node.linkCount	= (int)nodeLinks.size() - node.firstLink;
+				node.eliminated = node.parentLink != -1 ? node.linkCount - 1 : node.linkCount;
+				node.firstFactor = (int)factors.size();
+				factors.resize(factors.size() + node.linkCount * node.linkCount);
+				nodes.emplace_back(node);
+				continue;
+			}
+			int link = adjacency[nextEdges[current]++];
+			if (link == parentLinks[current]) {
+				continue;
+			}
+			int other = links[link].bodyA == treeBodies[current] ? links[link].bodyB : links[link].bodyA;
+			if (bodies[other].inverseMass == 0.0f) {
+				continue; //a static body only ever has the one link
+			}
+			int next = TreeIndex(other);
+			if (parentLinks[next] != unvisited) {
+				stack.clear();
+				return false;
+			}
+			parentLinks[next] = link;
+			stack.emplace_back(next);
+		}
+	}
+
+	//Each link's own term, from both of its bodies
+	pivots.assign(linkCount, 0.0f);
+	for (int i = 0; i < linkCount; ++i) {
+		const Link& link = links[i];
+		pivots[i] = Coupling(link.bodyA, i, i, bodies[link.bodyA].inverseMass) +
+					Coupling(link.bodyB, i, i, bodies[link.bodyB].inverseMass);
+	}
+	diagonals = pivots;
+	for (int i = 0; i < linkCount; ++i) {
+		pivots[i] += diagonals[i] * regularisation;
+	}
+
+	/*
+	The links around each body all affect each other, so each body's block
+	is a small dense matrix. The links to its children are eliminated here,
+	which is just a few steps of an ordinary dense LDL^T, with the changes
+	to each link's own term going to the shared pivots.
+	*/
+	for (const Node& node : nodes) {
+		int			count	= node.linkCount;
+		const int*	local	= &nodeLinks[node.firstLink];
+		float*		block	= &factors[node.firstFactor];
+		float		inverseMass = bodies[node.body].inverseMass;
+
+		for (int j = 0; j < count; ++j) {
+			for (int k = 0; k < j; ++k) {
+				block[j * count + k] = Coupling(node.body, local[j], local[k], inverseMass);
+			}
+		}
+
+		for (int i = 0; i < node.eliminated; ++i) {
+			float pivot = pivots[local[i]];
+			if (pivot <= diagonals[local[i]] * minimumPivot) {
+				return false;
+			}
+			for (int j = i + 1; j < count; ++j) {
+				float ji = block[j * count + i];
+				for (int k = i + 1; k < j; ++k) {
+					block[j * count + k] -= ji * block[k * count + i] / pivot;
+				}
+				pivots[local[j]] -= ji * ji / pivot;
+			}
+			for (int j = i + 1; j < count; ++j) {
+				block[j * count + i] /= pivot;
+			}
+		}
+	}
+	return true;
+}
+
+/*
+Forward substitution through L, a divide by D, and then back substitution
+through L^T, visiting the bodies in the opposite order. By the time a body
+is reached on the way back, its parent link's impulse is already known.
+*/
+void ChainSolver::Solve(const std::vector<float>& change, std::vector<float>& impulses) {
+	working = change;
+	impulses.resize(links.size());
+
+	for (const Node& node : nodes) {
+		int			count = node.linkCount;
+		const int*	local = &nodeLinks[node.firstLink];
+		const float* block = &factors[node.firstFactor];
+
+		for (int i = 0; i < node.eliminated; ++i) {
+			float value = working[local[i]];
+			for (int j = i + 1; j < count; ++j) {
+				working[local[j]] -= block[j * count + i] * value;
+			}
+		}
+	}
+
+	for (size_t i = 0; i < links.size(); ++i) {
+		working[i] /= pivots[i];
+	}
+
+	for (auto n = nodes.rbegin(); n != nodes.rend(); ++n) {
+		int			count = n->linkCount;
+		const int*	local = &nodeLinks[n->firstLink];
+		const float* block = &factors[n->firstFactor];
+
+		for (int i = n->eliminated - 1; i >= 0; --i) {
+			float value = working[local[i]];
+			for (int j = i + 1; j < count; ++j) {
+				value -= block[j * count + i] * impulses[local[j]];
+			}
+			impulses[local[i]] = value;
+		}
+	}
+}
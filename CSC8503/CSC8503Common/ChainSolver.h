@@ -0,0 +1,87 @@
+#pragma once
+#include "../../Common/Vector3.h"
+#include <vector>
+
+namespace NCL {
+	using namespace NCL::Maths;
+	namespace CSC8503 {
+		struct SolverBody;
+
+		/*
+		Solves a set of two sided rows exactly, rather than a little at a time,
+		as long as the rows and the moving bodies they join form a tree - no
+		body can be reached from another by two different routes. Chains of
+		links, like rope bridges, are the simplest case. Static bodies can be
+		attached anywhere, as the solver gives each row its own copy of them.
+
+		The rows' combined system (J M^-1 J^T) is factorised into L D L^T,
+		working in from the leaves of the tree. Two rows only affect each
+		other through a body they share, so eliminating a row only ever
+		changes the rows around its parent body, which already affect each
+		other anyway. Nothing gets filled in, so factorising, and every solve
+		after it, takes time proportional to the number of rows.
+		*/
+		class ChainSolver	{
+		public:
+			ChainSolver();
+			~ChainSolver();
+
+			void Clear();
+
+			//The terms are the same as a VelocityRow's, and can be left at zero to only move the centres
+			void AddLink(int bodyA, int bodyB, const Vector3& normal,
+				const Vector3& angularA = Vector3(), const Vector3& angularB = Vector3(),
+				const Vector3& inertiaA = Vector3(), const Vector3& inertiaB = Vector3());
+
+			//Fails if the links form a loop, or depend on each other too much to solve like this
+			bool Factorise(const std::vector<SolverBody>& bodies);
+
+			//Finds the impulse for each link that changes its relative velocity by the amount given
+			void Solve(const std::vector<float>& change, std::vector<float>& impulses);
+
+			int GetLinkCount() const {
+				return (int)links.size();
+			}
+
+		protected:
+			struct Link {
+				int		bodyA;
+				int		bodyB;
+				Vector3 normal;
+				Vector3 angularA;
+				Vector3 angularB;
+				Vector3 inertiaA;
+				Vector3 inertiaB;
+			};
+
+			//A moving body, and the links around it, with the link to its parent last
+			struct Node {
+				int		body;
+				int		parentLink;
+				int		firstLink;
+				int		linkCount;
+				int		eliminated;		//how many of the links are eliminated here - all but the parent link
+				int		firstFactor;	//linkCount * linkCount of them, only the lower part is used
+			};
+
+			float Coupling(int body, int linkA, int linkB, float inverseMass) const;
+			int   TreeIndex(int body) const;
+
+			std::vector<Link>	links;
+			std::vector<Node>	nodes;		//in the order they are eliminated, leaves first
+			std::vector<int>	nodeLinks;
+			std::vector<float>	factors;
+			std::vector<float>	pivots;		//D, one for each link
+
+			//Scratch space for building the tree, and for solving
+			std::vector<int>	treeBodies;
+			std::vector<int>	adjacency;
+			std::vector<int>	adjacencyStarts;
+			std::vector<int>	parentLinks;
+			std::vector<int>	nextEdges;
+			std::vector<int>	stack;
+			std::vector<float>	diagonals;
+			std::vector<float>	working;
+		};
+	}
+}
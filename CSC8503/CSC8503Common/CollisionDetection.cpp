@@ -3,10 +3,12 @@
 #include "AABBVolume.h"
 #include "OBBVolume.h"
 #include "SphereVolume.h"
+#include "CapsuleVolume.h"
 #include "../../Common/Vector2.h"
 #include "../../Common/Window.h"
 #include "../../Common/Maths.h"
 #include "Debug.h"
+#include "SATAlgorithm.h"
 
 #include <list>
 
@@ -333,7 +335,7 @@ Vector3	CollisionDetection::UnprojectScreenPosition(Vector3 position, float aspe
 	return Vector3(transformed.x / transformed.w, transformed.y / transformed.w, transformed.z / transformed.w);
 }
 
-bool CollisionDetection::ObjectIntersection(GameObject* a, GameObject* b, CollisionInfo& collisionInfo) {
+bool CollisionDetection::ObjectIntersection(GameObject* a, GameObject* b, CollisionInfo& collisionInfo, PairCache* cache) {
 	const CollisionVolume* volA = a->GetBoundingVolume();
 	const CollisionVolume* volB = b->GetBoundingVolume();
 
@@ -343,20 +345,18 @@ bool CollisionDetection::ObjectIntersection(GameObject* a, GameObject* b, Collis
 
 	collisionInfo.a = a;
 	collisionInfo.b = b;
+	collisionInfo.pointCount = 0;
 
 	Transform& transformA = a->GetTransform();
 	Transform& transformB = b->GetTransform();
 
 	switch (pairType)
 	{
-		case VolumeType::AABB:
-			return AABBIntersection((AABBVolume&)*volA, transformA, (AABBVolume&)*volB, transformB, collisionInfo);
-			break;
 		case VolumeType::Sphere:
 			return SphereIntersection((SphereVolume&)*volA, transformA, (SphereVolume&)*volB, transformB, collisionInfo);
 			break;
 		case VolumeType::OBB:
-			return OBBIntersection((OBBVolume&)*volA, transformA, (OBBVolume&)*volB, transformB, collisionInfo);
+			return OBBIntersection((OBBVolume&)*volA, transformA, (OBBVolume&)*volB, transformB, collisionInfo, cache ? &cache->separatingAxis : nullptr);
 			break;
 		case VolumeType::Capsule:
 			return CapsuleIntersection((CapsuleVolume&)*volA, transformA, (CapsuleVolume&)*volB, transformB, collisionInfo);
@@ -371,15 +371,74 @@ bool CollisionDetection::ObjectIntersection(GameObject* a, GameObject* b, Collis
 		return AABBSphereIntersection((AABBVolume&)*volB, transformB, (SphereVolume&)*volA, transformA, collisionInfo);
 	}
 
-	if (volA->type == VolumeType::Capsule && volB->type == VolumeType::Sphere) {
-		return SphereCapsuleIntersection((CapsuleVolume&)*volA, transformA, (SphereVolume&)*volB, transformB, collisionInfo);
+	//An AABB is a box that doesn't rotate, so it can use the same test as an OBB, which
+	//gives a whole face of contacts for boxes resting on each other rather than a single point
+	if (pairType == VolumeType::AABB || pairType == (VolumeType)((int)VolumeType::AABB | (int)VolumeType::OBB)) {
+		Quaternion orientationA = volA->type == VolumeType::OBB ? transformA.GetOrientation() : Quaternion();
+		Quaternion orientationB = volB->type == VolumeType::OBB ? transformB.GetOrientation() : Quaternion();
+		Vector3 sizeA = volA->type == VolumeType::OBB ? ((OBBVolume&)*volA).GetHalfDimensions() : ((AABBVolume&)*volA).GetHalfDimensions();
+		Vector3 sizeB = volB->type == VolumeType::OBB ? ((OBBVolume&)*volB).GetHalfDimensions() : ((AABBVolume&)*volB).GetHalfDimensions();
+
+		SATAlgorithm::Box boxA(transformA.GetPosition(), orientationA, sizeA);
+		SATAlgorithm::Box boxB(transformB.GetPosition(), orientationB, sizeB);
+		return SATAlgorithm::BoundingBoxSAT(boxA, boxB, collisionInfo, cache ? &cache->separatingAxis : nullptr);
 	}
-	if (volA->type == VolumeType::Sphere && volB->type == VolumeType::Capsule) {
-		std::swap(collisionInfo.a, collisionInfo.b);
-		return SphereCapsuleIntersection((CapsuleVolume&)*volB, transformB, (SphereVolume&)*volA, transformA, collisionInfo);
+
+	//Anything else, including every pair with a capsule in it, or an OBB and a sphere, goes through GJK
+	return ConvexIntersection(*volA, transformA, *volB, transformB, collisionInfo, cache ? &cache->simplex : nullptr);
+}
+
+/// <summary>Checks whether two objects are intersecting, without working out where. Used for sensors, which only need to know when something enters or leaves them.</summary>
+/// <param name='a'>Object A.</param>
+/// <param name='b'>Object B.</param>
+/// <returns>Boolean which returns whether objects A and B are intersecting.</returns>
+bool CollisionDetection::OverlapTest(GameObject* a, GameObject* b) {
+	const CollisionVolume* volA = a->GetBoundingVolume();
+	const CollisionVolume* volB = b->GetBoundingVolume();
+
+	if (!volA || !volB) return false;
+
+	if (volB->type == VolumeType::AABB && volA->type != VolumeType::AABB) {
+		std::swap(a, b);
+		std::swap(volA, volB);
 	}
+	Vector3 posA = a->GetTransform().GetPosition();
+	Vector3 posB = b->GetTransform().GetPosition();
 
-	return false;
+	if (volA->type == VolumeType::AABB && volB->type == VolumeType::AABB) {
+		return AABBTest(posA, posB, ((const AABBVolume&)*volA).GetHalfDimensions(), ((const AABBVolume&)*volB).GetHalfDimensions());
+	}
+	if (volA->type == VolumeType::AABB && volB->type == VolumeType::Sphere) {
+		Vector3 halfSize	= ((const AABBVolume&)*volA).GetHalfDimensions();
+		Vector3 closest		= Maths::Clamp(posB - posA, -halfSize, halfSize);
+		float	radius		= ((const SphereVolume&)*volB).GetRadius();
+		return (posB - posA - closest).LengthSquared() < radius * radius;
+	}
+	if (volA->type == VolumeType::Sphere && volB->type == VolumeType::Sphere) {
+		float radii = ((const SphereVolume&)*volA).GetRadius() + ((const SphereVolume&)*volB).GetRadius();
+		return (posB - posA).LengthSquared() < radii * radii;
+	}
+	return GJKAlgorithm::Overlaps(*volA, a->GetTransform(), *volB, b->GetTransform());
+}
+
+/// <summary>Detects whether two objects that aren't intersecting are close enough that they could be by the next step, using GJK.</summary>
+/// <param name='a'>Object A.</param>
+/// <param name='b'>Object B.</param>
+/// <param name='margin'>How far apart the objects can be and still be reported.</param>
+/// <param name='collisionInfo'>Struct containing data about the collision, with a negative penetration of how far apart the objects are.</param>
+/// <param name='cache'>The cache for this pair, whose simplex is used as a starting point and then replaced.</param>
+/// <returns>Boolean which returns whether objects A and B are less than <c>margin</c> apart.</returns>
+bool CollisionDetection::SpeculativeIntersection(GameObject* a, GameObject* b, float margin, CollisionInfo& collisionInfo, PairCache* cache) {
+	const CollisionVolume* volA = a->GetBoundingVolume();
+	const CollisionVolume* volB = b->GetBoundingVolume();
+
+	if (!volA || !volB) return false;
+
+	collisionInfo.a = a;
+	collisionInfo.b = b;
+	collisionInfo.pointCount = 0;
+
+	return ConvexIntersection(*volA, a->GetTransform(), *volB, b->GetTransform(), collisionInfo, cache ? &cache->simplex : nullptr, margin);
 }
 
 /// <summary>Checks whether 2 objects are intersecting on every axis.</summary>
@@ -577,18 +636,54 @@ bool CollisionDetection::CapsuleIntersection(const CapsuleVolume& volumeA, const
 Vector3 CollisionDetection::ClosestPointOnLine(const Vector3& capsuleBase, const Vector3& capsuleTip, const Vector3& point) {
 	Vector3 capsuleHeight = capsuleTip - capsuleBase;
 	float t = Vector3::Dot(point - capsuleBase, capsuleHeight) / Vector3::Dot(capsuleHeight, capsuleHeight);
-	float maxt = max(t, 0);
-	return capsuleBase + capsuleHeight * min(maxt, 1);
+	return capsuleBase + capsuleHeight * Maths::Clamp(t, 0.0f, 1.0f);
 }
 
+/// <summary>Detects whether two objects with oriented bounding box (OBB) volumes are intersecting, using the separating axis theorem.</summary>
+/// <param name='volumeA'>The OBB bounding volume of object A.</param>
+/// <param name='worldTransformA'>The world transform of object A.</param>
+/// <param name='volumeB'>The OBB bounding volume of object B.</param>
+/// <param name='worldTransformB'>The world transform of object B.</param>
+/// <param name='collisionInfo'>Struct containing data about the collision. At this stage, it should only contain both objects being tested.</param>
+/// <param name='cachedAxis'>The axis found the last time this pair was tested, if there is one. It's replaced by this test's.</param>
+/// <returns>Boolean which returns whether objects A and B are intersecting, adds up to 4 contact points to <c>collisionInfo</c></returns>
 bool CollisionDetection::OBBIntersection(
 	const OBBVolume& volumeA, const Transform& worldTransformA,
-	const OBBVolume& volumeB, const Transform& worldTransformB, CollisionInfo& collisionInfo) {
-	return false;
+	const OBBVolume& volumeB, const Transform& worldTransformB, CollisionInfo& collisionInfo, int* cachedAxis) {
+	SATAlgorithm::Box boxA(worldTransformA.GetPosition(), worldTransformA.GetOrientation(), volumeA.GetHalfDimensions());
+	SATAlgorithm::Box boxB(worldTransformB.GetPosition(), worldTransformB.GetOrientation(), volumeB.GetHalfDimensions());
+	return SATAlgorithm::BoundingBoxSAT(boxA, boxB, collisionInfo, cachedAxis);
 }
 
 bool CollisionDetection::SphereCapsuleIntersection(
 	const CapsuleVolume& volumeA, const Transform& worldTransformA,
 	const SphereVolume& volumeB, const Transform& worldTransformB, CollisionInfo& collisionInfo) {
-	return false;
+	return ConvexIntersection(volumeA, worldTransformA, (const CollisionVolume&)volumeB, worldTransformB, collisionInfo);
+}
+
+/// <summary>Detects whether any two convex volumes are intersecting, using GJK, and EPA if they are.</summary>
+/// <param name='volumeA'>The bounding volume of object A.</param>
+/// <param name='worldTransformA'>The world transform of object A.</param>
+/// <param name='volumeB'>The bounding volume of object B.</param>
+/// <param name='worldTransformB'>The world transform of object B.</param>
+/// <param name='collisionInfo'>Struct containing data about the collision. At this stage, it should only contain both objects being tested.</param>
+/// <param name='simplex'>The simplex from the last time this pair was tested, if there is one. It's replaced by this test's.</param>
+/// <param name='margin'>How far apart the volumes can be and still be reported, with a negative penetration.</param>
+/// <returns>Boolean which returns whether objects A and B are intersecting, adds more information about the collision to <c>collisionInfo</c></returns>
+bool CollisionDetection::ConvexIntersection(const CollisionVolume& volumeA, const Transform& worldTransformA,
+	const CollisionVolume& volumeB, const Transform& worldTransformB, CollisionInfo& collisionInfo, GJKSimplex* simplex, float margin) {
+	const int convexTypes = (int)VolumeType::AABB | (int)VolumeType::OBB | (int)VolumeType::Sphere | (int)VolumeType::Capsule;
+	if (!((int)volumeA.type & convexTypes) || !((int)volumeB.type & convexTypes)) {
+		return false;
+	}
+
+	GJKContact contact;
+	if (!GJKAlgorithm::Intersection(volumeA, worldTransformA, volumeB, worldTransformB, contact, simplex, margin)) {
+		return false;
+	}
+	Vector3 localA = contact.pointA - worldTransformA.GetPosition();
+	Vector3 localB = contact.pointB - worldTransformB.GetPosition();
+
+	collisionInfo.AddContactPoint(localA, localB, contact.normal, contact.penetration);
+	return true;
 }
\ No newline at end of file
@@ -11,6 +11,7 @@
 #include "SphereVolume.h"
 #include "CapsuleVolume.h"
 #include "Ray.h"
+#include "GJKAlgorithm.h"
 
 using NCL::Camera;
 using namespace NCL::Maths;
@@ -25,14 +26,33 @@ namespace NCL {
 			Vector3 normal;
 			float	penetration;
 		};
+		static const int MAX_CONTACT_POINTS = 4;
+
+		//What the narrowphase remembers about a pair, to give it a head start the next time it's tested
+		struct PairCache {
+			GJKSimplex	simplex;
+			int			separatingAxis	= -1;	//the SAT axis that separated the pair, or that it overlapped least along
+			int			lastUpdate		= 0;	//the substep it was last used in, for whoever is keeping it
+
+			bool IsUsed() const {
+				return simplex.count > 0 || separatingAxis >= 0;
+			}
+		};
+
 		struct CollisionInfo {
 			GameObject* a;
 			GameObject* b;		
 			mutable int		framesLeft;
 
-			ContactPoint point;
+			ContactPoint points[MAX_CONTACT_POINTS];
+			int			 pointCount = 0;
 
+			//Any points past the limit are ignored
 			void AddContactPoint(const Vector3& localA, const Vector3& localB, const Vector3& normal, float p) {
+				if (pointCount == MAX_CONTACT_POINTS) {
+					return;
+				}
+				ContactPoint& point = points[pointCount++];
 				point.localA		= localA;
 				point.localB		= localB;
 				point.normal		= normal;
@@ -78,7 +98,14 @@ namespace NCL {
 		static bool	AABBTest(const Vector3& posA, const Vector3& posB, const Vector3& halfSizeA, const Vector3& halfSizeB);
 
 
-		static bool ObjectIntersection(GameObject* a, GameObject* b, CollisionInfo& collisionInfo);
+		//Pairs tested with GJK or SAT start from what's in the cache, if given, and then update it
+		static bool ObjectIntersection(GameObject* a, GameObject* b, CollisionInfo& collisionInfo, PairCache* cache = nullptr);
+
+		//Just whether the objects are touching, without working out any contact points
+		static bool OverlapTest(GameObject* a, GameObject* b);
+
+		//Finds objects that aren't touching yet, but are less than margin apart
+		static bool SpeculativeIntersection(GameObject* a, GameObject* b, float margin, CollisionInfo& collisionInfo, PairCache* cache = nullptr);
 
 
 		static bool AABBIntersection(	const AABBVolume& volumeA, const Transform& worldTransformA,
@@ -91,11 +118,14 @@ namespace NCL {
 										const SphereVolume& volumeB, const Transform& worldTransformB, CollisionInfo& collisionInfo);
 
 		static bool OBBIntersection(	const OBBVolume& volumeA, const Transform& worldTransformA,
-										const OBBVolume& volumeB, const Transform& worldTransformB, CollisionInfo& collisionInfo);
+										const OBBVolume& volumeB, const Transform& worldTransformB, CollisionInfo& collisionInfo, int* cachedAxis = nullptr);
 
 		static bool CapsuleIntersection(const CapsuleVolume& volumeA, const Transform& worldTransformA,
 										const CapsuleVolume& volumeB, const Transform& worldTransformB, CollisionInfo& collisionInfo);
 
+		static bool ConvexIntersection(const CollisionVolume& volumeA, const Transform& worldTransformA,
+										const CollisionVolume& volumeB, const Transform& worldTransformB, CollisionInfo& collisionInfo, GJKSimplex* simplex = nullptr, float margin = 0.0f);
+
 		static Vector3 ClosestPointOnLine(const Vector3& a, const Vector3& b, const Vector3& point);
 
 		static Vector3 Unproject(const Vector3& screenPos, const Camera& cam);
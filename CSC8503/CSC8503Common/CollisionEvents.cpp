@@ -0,0 +1,38 @@
+#include "CollisionEvents.h"
+
+using namespace NCL;
+using namespace CSC8503;
+
+/*
+Events that haven't been drained yet are kept, and the new ones are added
+after them, so nothing is lost if a frame goes by without a drain.
+*/
+void CollisionEventQueue::Publish() {
+	if (pending.empty()) {
+		return;
+	}
+	std::lock_guard<std::mutex> lock(publishedLock);
+	if (published.empty()) {
+		published.swap(pending);
+	}
+	else {
+		published.insert(published.end(), pending.begin(), pending.end());
+	}
+	pending.clear();
+}
+
+/*
+The caller's list is swapped in, rather than copied into, so both lists
+keep their memory, and draining every frame doesn't allocate anything.
+*/
+void CollisionEventQueue::Drain(std::vector<CollisionEvent>& events) {
+	events.clear();
+	std::lock_guard<std::mutex> lock(publishedLock);
+	events.swap(published);
+}
+
+void CollisionEventQueue::Clear() {
+	pending.clear();
+	std::lock_guard<std::mutex> lock(publishedLock);
+	published.clear();
+}
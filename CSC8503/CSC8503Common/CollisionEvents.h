@@ -0,0 +1,58 @@
+#pragma once
+#include <vector>
+#include <mutex>
+
+namespace NCL {
+	namespace CSC8503 {
+		class GameObject;
+
+		enum class CollisionEventType {
+			Begin,			//the pair started touching this frame
+			Stay,			//the pair was found touching this frame, including the frame it began in
+			End,			//the pair hasn't been found touching for a few frames
+			TriggerEnter,	//b started overlapping the sensor a
+			TriggerLeave	//b stopped overlapping the sensor a
+		};
+
+		struct CollisionEvent {
+			CollisionEventType	type;
+			GameObject*			a;	//the sensor, for trigger events
+			GameObject*			b;
+		};
+
+		/*
+		Collision events are queued up while the world is being stepped, rather
+		than acted on there and then, so gameplay code never runs in the middle
+		of the narrowphase or the solver, and can't move or remove objects that
+		physics is still working on.
+
+		Physics pushes events into a pending list as it finds them, and publishes
+		them once a frame, after its last substep. Whoever is handling them then
+		drains everything published so far in one go. Pushing and publishing must
+		be done on one thread, but draining is locked, so the events can be
+		handled on a different thread to the one stepping the world.
+		*/
+		class CollisionEventQueue	{
+		public:
+			CollisionEventQueue() {}
+			~CollisionEventQueue() {}
+
+			void Push(CollisionEventType type, GameObject* a, GameObject* b) {
+				pending.push_back({ type, a, b });
+			}
+
+			//Makes everything pushed since the last publish available to Drain
+			void Publish();
+
+			//Swaps the published events into events, which is emptied first
+			void Drain(std::vector<CollisionEvent>& events);
+
+			void Clear();
+
+		protected:
+			std::vector<CollisionEvent> pending;
+			std::vector<CollisionEvent> published;
+			std::mutex					publishedLock;
+		};
+	}
+}
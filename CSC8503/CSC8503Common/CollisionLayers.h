@@ -0,0 +1,67 @@
+#pragma once
+#include <cstdint>
+
+namespace NCL {
+	namespace CSC8503 {
+		//Each object is on one of up to 32 layers
+		enum class CollisionLayer {
+			Default,
+			Static,		//floors, walls and anything else that never moves
+			Player,
+			Obstacle,
+			Bonus,		//only ever picked up by players
+			MaxLayers = 32
+		};
+
+		/*
+		Which layers collide with which. An object is given its layer's row of
+		the matrix as its mask when it's put on that layer, and the broadphase
+		only passes on a pair if each object's layer is in the other's mask.
+		The matrix should be set up before any objects are put on its layers,
+		as the objects keep their own copy of the mask.
+
+		Everything collides with everything else by default, apart from static
+		objects with each other, and bonuses with anything but players.
+		*/
+		class CollisionLayerMatrix	{
+		public:
+			static CollisionLayerMatrix& Get() {
+				static CollisionLayerMatrix matrix;
+				return matrix;
+			}
+
+			void SetCollides(CollisionLayer a, CollisionLayer b, bool state) {
+				uint32_t bitA = GetCategory(a);
+				uint32_t bitB = GetCategory(b);
+				masks[(int)a] = state ? masks[(int)a] | bitB : masks[(int)a] & ~bitB;
+				masks[(int)b] = state ? masks[(int)b] | bitA : masks[(int)b] & ~bitA;
+			}
+
+			bool Collides(CollisionLayer a, CollisionLayer b) const {
+				return (masks[(int)a] & GetCategory(b)) != 0;
+			}
+
+			uint32_t GetMask(CollisionLayer layer) const {
+				return masks[(int)layer];
+			}
+
+			static uint32_t GetCategory(CollisionLayer layer) {
+				return 1u << (int)layer;
+			}
+
+		protected:
+			CollisionLayerMatrix() {
+				for (uint32_t& mask : masks) {
+					mask = ~0u;
+				}
+				SetCollides(CollisionLayer::Static, CollisionLayer::Static, false);
+				for (int i = 0; i < (int)CollisionLayer::MaxLayers; ++i) {
+					SetCollides(CollisionLayer::Bonus, (CollisionLayer)i, false);
+				}
+				SetCollides(CollisionLayer::Bonus, CollisionLayer::Player, true);
+			}
+
+			uint32_t masks[(int)CollisionLayer::MaxLayers];
+		};
+	}
+}
@@ -2,12 +2,31 @@
 
 namespace NCL {
 	namespace CSC8503 {
+		class GameObject;
+		class ConstraintSolver;
+
+		//Constraints describe themselves as rows for the ConstraintSolver each substep
 		class Constraint	{
 		public:
-			Constraint() {}
+			Constraint(GameObject* a, GameObject* b) {
+				objectA = a;
+				objectB = b;
+			}
 			virtual ~Constraint() {}
 
-			virtual void UpdateConstraint(float dt) = 0;
+			virtual void AddRows(ConstraintSolver& solver, float dt) = 0;
+
+			GameObject* GetObjectA() const {
+				return objectA;
+			}
+
+			GameObject* GetObjectB() const {
+				return objectB;
+			}
+
+		protected:
+			GameObject* objectA;
+			GameObject* objectB;
 		};
 	}
 }
\ No newline at end of file
@@ -0,0 +1,521 @@
+#include "ConstraintSolver.h"
+#include "GameObject.h"
+#include "PhysicsObject.h"
+#include "WorkerPool.h"
+#include <algorithm>
+#include <cfloat>
+
+using namespace NCL;
+using namespace CSC8503;
+
+namespace {
+	const int colourIslandRows	= 128;	//islands with fewer velocity rows than this are solved whole
+	const int colourBlockSize	= 32;	//rows per job when a batch is split across threads
+	const int maxColours		= 64;	//one for each bit of a body's colour mask
+	const int minimumChainRows	= 2;	//a single row is solved exactly by iterating anyway
+
+	bool IsTwoSided(const VelocityRow& row) {
+		return row.lowerLimit == -FLT_MAX && row.upperLimit == FLT_MAX;
+	}
+
+	/*
+	Greedily colours the rows in [first, last), then sorts them by colour,
+	keeping them in the order they were added within each colour. Static
+	bodies are copied for every manifold or constraint rather than shared,
+	so they can be treated just like the moving ones.
+	*/
+	template <typename Row>
+	void ColourRows(std::vector<Row>& rows, std::vector<Row>& scratch, int first, int last,
+		std::vector<uint64_t>& bodyColours, std::vector<ColourBatch>& batches) {
+		int counts[maxColours + 1] = { 0 };
+
+		for (int i = first; i < last; ++i) {
+			bodyColours[rows[i].bodyA] = 0;
+			bodyColours[rows[i].bodyB] = 0;
+		}
+
+		std::vector<int> rowColours(last - first);
+		for (int i = first; i < last; ++i) {
+			uint64_t used = bodyColours[rows[i].bodyA] | bodyColours[rows[i].bodyB];
+
+			int colour = 0;
+			while (colour < maxColours && (used & ((uint64_t)1 << colour))) {
+				colour++;
+			}
+			if (colour < maxColours) {
+				bodyColours[rows[i].bodyA] |= (uint64_t)1 << colour;
+				bodyColours[rows[i].bodyB] |= (uint64_t)1 << colour;
+			}
+			rowColours[i - first] = colour;
+			counts[colour]++;
+		}
+
+		int starts[maxColours + 1];
+		int start = first;
+		for (int c = 0; c <= maxColours; ++c) {
+			starts[c] = start;
+			if (counts[c] > 0) {
+				batches.push_back({ start, start + counts[c], c == maxColours });
+			}
+			start += counts[c];
+		}
+
+		if (scratch.size() < rows.size()) {
+			scratch.resize(rows.size());
+		}
+		for (int i = first; i < last; ++i) {
+			scratch[starts[rowColours[i - first]]++] = rows[i];
+		}
+		std::copy(scratch.begin() + first, scratch.begin() + last, rows.begin() + first);
+	}
+}
+
+ConstraintSolver::ConstraintSolver() {
+	currentIsland		= 0;
+	islandCount			= 1;
+	twoSidedRowCount	= 0;
+	chainCount			= 0;
+}
+
+ConstraintSolver::~ConstraintSolver() {
+}
+
+void ConstraintSolver::Clear() {
+	bodies.clear();
+	velocityRows.clear();
+	positionRows.clear();
+	currentIsland		= 0;
+	islandCount			= 1;
+	twoSidedRowCount	= 0;
+}
+
+/*
+Each moving object is only copied into the solver once, the first time a
+row refers to it. Its PhysicsObject remembers where it ended up until the
+results are written back at the end of Solve.
+
+Static objects get a fresh copy for every row instead, so that no two
+islands ever share a body. They can't be moved by the solver, so their
+copies are never written back.
+*/
+int ConstraintSolver::AddBody(GameObject* object) {
+	PhysicsObject* phys = object->GetPhysicsObject();
+	bool isStatic = phys->GetInverseMass() == 0;
+	if (!isStatic && phys->GetSolverIndex() != -1) {
+		return phys->GetSolverIndex();
+	}
+	int index = (int)bodies.size();
+
+	if (!isStatic) {
+		phys->UpdateInertiaTensor();
+	}
+
+	SolverBody body;
+	body.object				= object;
+	body.linearVelocity		= phys->GetLinearVelocity();
+	body.angularVelocity	= phys->GetAngularVelocity();
+	body.inverseInertia		= isStatic ? Matrix3::Scale(Vector3()) : phys->GetInertiaTensor();
+	body.inverseMass		= phys->GetInverseMass();
+	bodies.emplace_back(body);
+
+	if (!isStatic) {
+		phys->SetSolverIndex(index);
+	}
+	return index;
+}
+
+/*
+Everything that doesn't change between iterations is worked out as the
+row is added, along with the impulse it should start from.
+*/
+void ConstraintSolver::AddVelocityRow(int a, int b, const Vector3& normal, const Vector3& localA, const Vector3& localB,
+	float bias, float lowerLimit, float upperLimit, float* accumulated) {
+	const SolverBody& bodyA = bodies[a];
+	const SolverBody& bodyB = bodies[b];
+
+	VelocityRow row;
+	row.bodyA		= a;
+	row.bodyB		= b;
+	row.normal		= normal;
+	row.angularA	= Vector3::Cross(localA, normal);
+	row.angularB	= Vector3::Cross(localB, normal);
+	row.inertiaA	= bodyA.inverseInertia * row.angularA;
+	row.inertiaB	= bodyB.inverseInertia * row.angularB;
+
+	float k = bodyA.inverseMass + bodyB.inverseMass +
+		Vector3::Dot(row.inertiaA, row.angularA) + Vector3::Dot(row.inertiaB, row.angularB);
+
+	row.effectiveMass	= k > 0.0f ? 1.0f / k : 0.0f; // two static objects won't move anyway
+	row.bias			= bias;
+	row.impulse			= accumulated ? *accumulated : 0.0f;
+	row.lowerLimit		= lowerLimit;
+	row.upperLimit		= upperLimit;
+	row.accumulated		= accumulated;
+	row.island			= currentIsland;
+	row.direct			= false;
+	velocityRows.emplace_back(row);
+
+	if (IsTwoSided(row)) {
+		twoSidedRowCount++;
+	}
+}
+
+void ConstraintSolver::AddPositionRow(int a, int b, const Vector3& normal, float error, bool oneSided) {
+	PositionRow row;
+	row.bodyA		= a;
+	row.bodyB		= b;
+	row.normal		= normal;
+	row.error		= error;
+	row.oneSided	= oneSided;
+	row.island		= currentIsland;
+	positionRows.emplace_back(row);
+}
+
+/*
+Islands can be solved in any order, as they don't share any moving
+bodies, so the small ones are handed out to the pool's threads whole.
+Coloured islands are done afterwards, one at a time, with each of their
+batches spread across every thread.
+*/
+void ConstraintSolver::Solve(int velocityIterations, int positionIterations, WorkerPool* pool) {
+	bool threaded = pool && pool->GetThreadCount() > 1;
+
+	if (islandCount == 1) {
+		velocityStarts.assign({ 0, (int)velocityRows.size() });
+		positionStarts.assign({ 0, (int)positionRows.size() });
+	}
+	else {
+		GroupByIsland();
+	}
+	BuildChains();
+
+	colouredIslands.clear();
+	velocityBatches.clear();
+	positionBatches.clear();
+	islandColoured.assign(islandCount, false);
+	for (int i = 0; i < islandCount; ++i) {
+		if (velocityStarts[i + 1] - velocityStarts[i] >= colourIslandRows) {
+			ColourIsland(i);
+		}
+	}
+
+	auto solveIslands = [&](int begin, int end, int thread) {
+		for (int i = begin; i < end; ++i) {
+			if (!islandColoured[i]) {
+				SolveIsland(i, velocityIterations, positionIterations);
+			}
+		}
+	};
+	if (threaded) {
+		pool->ParallelFor(islandCount, 1, solveIslands);
+	}
+	else {
+		solveIslands(0, islandCount, 0);
+	}
+
+	for (const ColouredIsland& coloured : colouredIslands) {
+		SolveColouredIsland(coloured, velocityIterations, positionIterations, threaded ? pool : nullptr);
+	}
+	StoreResults();
+}
+
+/*
+A counting sort, so that each island's rows end up next to each other,
+still in the order they were added.
+*/
+void ConstraintSolver::GroupByIsland() {
+	velocityStarts.assign(islandCount + 1, 0);
+	positionStarts.assign(islandCount + 1, 0);
+
+	for (const VelocityRow& row : velocityRows) {
+		velocityStarts[row.island + 1]++;
+	}
+	for (const PositionRow& row : positionRows) {
+		positionStarts[row.island + 1]++;
+	}
+	for (int i = 0; i < islandCount; ++i) {
+		velocityStarts[i + 1] += velocityStarts[i];
+		positionStarts[i + 1] += positionStarts[i];
+	}
+
+	sortedVelocityRows.resize(velocityRows.size());
+	sortedPositionRows.resize(positionRows.size());
+
+	for (const VelocityRow& row : velocityRows) {
+		sortedVelocityRows[velocityStarts[row.island]++] = row;
+	}
+	for (const PositionRow& row : positionRows) {
+		sortedPositionRows[positionStarts[row.island]++] = row;
+	}
+	velocityRows.swap(sortedVelocityRows);
+	positionRows.swap(sortedPositionRows);
+
+	//The starts were moved along to the end of each island while copying
+	for (int i = islandCount; i > 0; --i) {
+		velocityStarts[i] = velocityStarts[i - 1];
+		positionStarts[i] = positionStarts[i - 1];
+	}
+	velocityStarts[0] = 0;
+	positionStarts[0] = 0;
+}
+
+void ConstraintSolver::SolveIsland(int island, int velocityIterations, int positionIterations) {
+	int firstVelocity	= velocityStarts[island];
+	int lastVelocity	= velocityStarts[island + 1];
+	int firstPosition	= positionStarts[island];
+	int lastPosition	= positionStarts[island + 1];
+
+	PrepareChain(island);
+
+	WarmStart(firstVelocity, lastVelocity);
+	for (int i = 0; i < velocityIterations; ++i) {
+		SolveVelocities(firstVelocity, lastVelocity);
+		SolveChainVelocities(island);
+	}
+	for (int i = 0; i < positionIterations; ++i) {
+		SolvePositions(firstPosition, lastPosition);
+	}
+}
+
+/*
+Works out which islands have enough two sided rows to be worth trying to
+solve directly, and gives each of them an IslandChain. The chains are
+actually built as each island is solved, so they can be built in parallel.
+*/
+void ConstraintSolver::BuildChains() {
+	chainCount = 0;
+	if (twoSidedRowCount < minimumChainRows) {
+		islandChains.clear();
+		return;
+	}
+	islandChains.assign(islandCount, -1);
+
+	for (int i = 0; i < islandCount; ++i) {
+		int twoSided = 0;
+		for (int j = velocityStarts[i]; j < velocityStarts[i + 1]; ++j) {
+			twoSided += IsTwoSided(velocityRows[j]) ? 1 : 0;
+		}
+		if (twoSided >= minimumChainRows) {
+			islandChains[i] = chainCount++;
+		}
+	}
+	if ((int)chains.size() < chainCount) {
+		chains.resize(chainCount);
+	}
+}
+
+/*
+If the island's two sided rows don't form a tree, they're left to be
+iterated along with everything else.
+*/
+void ConstraintSolver::PrepareChain(int island) {
+	if (islandChains.empty() || islandChains[island] == -1) {
+		return;
+	}
+	IslandChain& chain = chains[islandChains[island]];
+
+	chain.solver.Clear();
+	chain.rows.clear();
+	for (int i = velocityStarts[island]; i < velocityStarts[island + 1]; ++i) {
+		const VelocityRow& row = velocityRows[i];
+		if (IsTwoSided(row)) {
+			chain.solver.AddLink(row.bodyA, row.bodyB, row.normal, row.angularA, row.angularB, row.inertiaA, row.inertiaB);
+			chain.rows.emplace_back(i);
+		}
+	}
+	if (chain.solver.Factorise(bodies)) {
+		for (int i : chain.rows) {
+			velocityRows[i].direct = true;
+		}
+	}
+	else {
+		chain.rows.clear();
+	}
+}
+
+/*
+Finds the impulses that take every row in the chain to exactly the
+relative velocity it wants, given what the bodies are doing now.
+*/
+void ConstraintSolver::SolveChainVelocities(int island) {
+	if (islandChains.empty() || islandChains[island] == -1) {
+		return;
+	}
+	IslandChain& chain = chains[islandChains[island]];
+	if (chain.rows.empty()) {
+		return;
+	}
+
+	chain.change.resize(chain.rows.size());
+	for (size_t i = 0; i < chain.rows.size(); ++i) {
+		const VelocityRow& row = velocityRows[chain.rows[i]];
+		const SolverBody& a = bodies[row.bodyA];
+		const SolverBody& b = bodies[row.bodyB];
+
+		float relativeVelocity = Vector3::Dot(b.linearVelocity - a.linearVelocity, row.normal) +
+			Vector3::Dot(b.angularVelocity, row.angularB) - Vector3::Dot(a.angularVelocity, row.angularA);
+
+		chain.change[i] = row.bias - relativeVelocity;
+	}
+
+	chain.solver.Solve(chain.change, chain.impulses);
+
+	for (size_t i = 0; i < chain.rows.size(); ++i) {
+		VelocityRow& row = velocityRows[chain.rows[i]];
+		SolverBody& a = bodies[row.bodyA];
+		SolverBody& b = bodies[row.bodyB];
+		float j = chain.impulses[i];
+
+		row.impulse += j;
+		a.linearVelocity	-= row.normal * (j * a.inverseMass);
+		b.linearVelocity	+= row.normal * (j * b.inverseMass);
+		a.angularVelocity	-= row.inertiaA * j;
+		b.angularVelocity	+= row.inertiaB * j;
+	}
+}
+
+void ConstraintSolver::ColourIsland(int island) {
+	bodyColours.resize(bodies.size());
+
+	ColouredIsland coloured;
+	coloured.island				= island;
+	coloured.firstVelocityBatch = (int)velocityBatches.size();
+	ColourRows(velocityRows, sortedVelocityRows, velocityStarts[island], velocityStarts[island + 1], bodyColours, velocityBatches);
+	coloured.lastVelocityBatch	= (int)velocityBatches.size();
+
+	coloured.firstPositionBatch = (int)positionBatches.size();
+	ColourRows(positionRows, sortedPositionRows, positionStarts[island], positionStarts[island + 1], bodyColours, positionBatches);
+	coloured.lastPositionBatch	= (int)positionBatches.size();
+
+	colouredIslands.emplace_back(coloured);
+	islandColoured[island] = true;
+}
+
+/*
+Every iteration goes through the batches in order, with the rows of each
+batch split between the threads. A batch has to be completely finished
+before the next can start, as it will be touching the same bodies.
+*/
+void ConstraintSolver::SolveColouredIsland(const ColouredIsland& coloured, int velocityIterations, int positionIterations, WorkerPool* pool) {
+	auto solveBatches = [&](const std::vector<ColourBatch>& batches, int firstBatch, int lastBatch, void (ConstraintSolver::*solve)(int, int)) {
+		for (int i = firstBatch; i < lastBatch; ++i) {
+			const ColourBatch& batch = batches[i];
+			if (!pool || batch.serial) {
+				(this->*solve)(batch.first, batch.last);
+				continue;
+			}
+			pool->ParallelFor(batch.last - batch.first, colourBlockSize, [&](int begin, int end, int thread) {
+				(this->*solve)(batch.first + begin, batch.first + end);
+			});
+		}
+	};
+
+	PrepareChain(coloured.island);
+
+	solveBatches(velocityBatches, coloured.firstVelocityBatch, coloured.lastVelocityBatch, &ConstraintSolver::WarmStart);
+	for (int i = 0; i < velocityIterations; ++i) {
+		solveBatches(velocityBatches, coloured.firstVelocityBatch, coloured.lastVelocityBatch, &ConstraintSolver::SolveVelocities);
+		SolveChainVelocities(coloured.island);
+	}
+	for (int i = 0; i < positionIterations; ++i) {
+		solveBatches(positionBatches, coloured.firstPositionBatch, coloured.lastPositionBatch, &ConstraintSolver::SolvePositions);
+	}
+}
+
+//Applies the impulses the rows ended up with last substep
+void ConstraintSolver::WarmStart(int first, int last) {
+	for (int i = first; i < last; ++i) {
+		VelocityRow& row = velocityRows[i];
+		if (row.impulse == 0.0f) {
+			continue;
+		}
+		SolverBody& a = bodies[row.bodyA];
+		SolverBody& b = bodies[row.bodyB];
+
+		a.linearVelocity	-= row.normal * (row.impulse * a.inverseMass);
+		b.linearVelocity	+= row.normal * (row.impulse * b.inverseMass);
+		a.angularVelocity	-= row.inertiaA * row.impulse;
+		b.angularVelocity	+= row.inertiaB * row.impulse;
+	}
+}
+
+/*
+The impulse each row needs to reach its target velocity is added on to
+the total impulse applied so far, which is then clamped to the row's
+limits. Only the change in the total is actually applied to the bodies.
+*/
+void ConstraintSolver::SolveVelocities(int first, int last) {
+	for (int i = first; i < last; ++i) {
+		VelocityRow& row = velocityRows[i];
+		if (row.direct) {
+			continue;
+		}
+		SolverBody& a = bodies[row.bodyA];
+		SolverBody& b = bodies[row.bodyB];
+
+		float relativeVelocity = Vector3::Dot(b.linearVelocity - a.linearVelocity, row.normal) +
+			Vector3::Dot(b.angularVelocity, row.angularB) - Vector3::Dot(a.angularVelocity, row.angularA);
+
+		float j = (row.bias - relativeVelocity) * row.effectiveMass;
+
+		float oldImpulse = row.impulse;
+		float newImpulse = oldImpulse + j;
+		newImpulse = newImpulse < row.lowerLimit ? row.lowerLimit : newImpulse;
+		newImpulse = newImpulse > row.upperLimit ? row.upperLimit : newImpulse;
+		row.impulse = newImpulse;
+		j = newImpulse - oldImpulse;
+
+		a.linearVelocity	-= row.normal * (j * a.inverseMass);
+		b.linearVelocity	+= row.normal * (j * b.inverseMass);
+		a.angularVelocity	-= row.inertiaA * j;
+		b.angularVelocity	+= row.inertiaB * j;
+	}
+}
+
+/*
+Moves the bodies apart by however much of each row's error is left,
+shared out by inverse mass, like the projection we used to do for every
+collision. Positions are only moved, so no velocity is added.
+*/
+void ConstraintSolver::SolvePositions(int first, int last) {
+	for (int i = first; i < last; ++i) {
+		const PositionRow& row = positionRows[i];
+		SolverBody& a = bodies[row.bodyA];
+		SolverBody& b = bodies[row.bodyB];
+
+		float totalMass = a.inverseMass + b.inverseMass;
+		if (totalMass == 0.0f) {
+			continue;
+		}
+		float error = row.error + Vector3::Dot(b.positionDelta - a.positionDelta, row.normal);
+		if (row.oneSided && error >= 0.0f) {
+			continue;
+		}
+		float correction = -error / totalMass;
+
+		a.positionDelta -= row.normal * (correction * a.inverseMass);
+		b.positionDelta += row.normal * (correction * b.inverseMass);
+	}
+}
+
+void ConstraintSolver::StoreResults() {
+	for (const VelocityRow& row : velocityRows) {
+		if (row.accumulated) {
+			*row.accumulated = row.impulse;
+		}
+	}
+	for (const SolverBody& body : bodies) {
+		if (body.inverseMass == 0) {
+			continue;
+		}
+		PhysicsObject* phys = body.object->GetPhysicsObject();
+		phys->SetLinearVelocity(body.linearVelocity);
+		phys->SetAngularVelocity(body.angularVelocity);
+		phys->SetSolverIndex(-1);
+
+		//The pool's copy of the position is what gets integrated next
+		Transform& transform = body.object->GetTransform();
+		transform.SetPosition(transform.GetPosition() + body.positionDelta);
+		phys->GetBodyPool()->SetVector(RigidBodyPool::PositionX, phys->GetBodyHandle(), transform.GetPosition());
+	}
+}
@@ -0,0 +1,185 @@
+#pragma once
+#include "../../Common/Vector3.h"
+#include "../../Common/Matrix3.h"
+#include "ChainSolver.h"
+#include <vector>
+#include <cstdint>
+
+namespace NCL {
+	using namespace NCL::Maths;
+	namespace CSC8503 {
+		class GameObject;
+		class WorkerPool;
+
+		//A copy of the parts of a PhysicsObject the solver reads and writes
+		struct SolverBody {
+			GameObject* object;
+			Vector3		linearVelocity;
+			Vector3		angularVelocity;
+			Vector3		positionDelta;	//how far the position iterations have moved the body
+			Matrix3		inverseInertia;
+			float		inverseMass;
+		};
+
+		/*
+		A single velocity constraint between two bodies. The impulse is applied
+		along the normal, at an offset from the centre of each body, and is kept
+		between the lower and upper limits across all iterations - contacts can
+		only push (lower limit 0), while joints can push or pull.
+		*/
+		struct VelocityRow {
+			int		bodyA;
+			int		bodyB;
+			Vector3 normal;		//from A towards B
+			Vector3 angularA;	//localA x normal
+			Vector3 angularB;	//localB x normal
+			Vector3 inertiaA;	//change in angular velocity per unit of impulse
+			Vector3 inertiaB;
+			float	effectiveMass;
+			float	bias;		//the relative velocity along the normal we want to end up with
+			float	impulse;	//accumulated over every iteration
+			float	lowerLimit;
+			float	upperLimit;
+			float*	accumulated; //where the final impulse is kept for warm starting, may be null
+			int		island;
+			bool	direct;		//solved by the island's ChainSolver instead of iterated
+		};
+
+		/*
+		A position error between the centres of two bodies, measured along a
+		normal that is fixed for the substep. One sided rows (contacts) only
+		ever push the bodies apart.
+		*/
+		struct PositionRow {
+			int		bodyA;
+			int		bodyB;
+			Vector3 normal;
+			float	error;		//how far the bodies were from where they should be
+			bool	oneSided;
+			int		island;
+		};
+
+		//A run of rows that share no moving bodies, so can be solved in any order, or all at once
+		struct ColourBatch {
+			int		first;
+			int		last;
+			bool	serial; //the leftover rows that didn't fit in any batch, which do share bodies
+		};
+
+		//An island big enough to have its rows split up into ColourBatches
+		struct ColouredIsland {
+			int island;
+			int firstVelocityBatch;
+			int lastVelocityBatch;
+			int firstPositionBatch;
+			int lastPositionBatch;
+		};
+
+		//The two sided rows of an island, if they form a tree and can be solved directly
+		struct IslandChain {
+			ChainSolver			solver;
+			std::vector<int>	rows;
+			std::vector<float>	change;
+			std::vector<float>	impulses;
+		};
+
+		/*
+		Solves every contact and Constraint in the world together, as rows of
+		a sequential impulse solver. The rows for a substep are gathered into
+		contiguous arrays, the velocity rows are iterated to find the impulses,
+		and then the position rows are iterated to push the bodies back to
+		where they should be, without adding any energy to them.
+
+		Rows are tagged with the island they belong to. Islands don't share any
+		moving bodies, so given a WorkerPool, each island can be solved on its
+		own thread, with exactly the same results as solving them all in turn.
+
+		That doesn't help a single big island, like a long bridge or a large
+		pile, so the rows of big islands are also coloured - each row is put
+		in the first batch that doesn't already have one of its bodies in it.
+		Each batch can then be split across every thread, one after another.
+		Big islands are always solved batch by batch, however many threads
+		there are, so the results still don't depend on the thread count.
+
+		Iterating a long chain of joints only passes an impulse along it a
+		link at a time, so chains take many iterations to go stiff. If the
+		two sided rows of an island (the joints) form a tree, they are given
+		to a ChainSolver, and solved exactly after each iteration over the
+		rest of the island's rows instead.
+		*/
+		class ConstraintSolver	{
+		public:
+			ConstraintSolver();
+			~ConstraintSolver();
+
+			void Clear();
+
+			int AddBody(GameObject* object);
+
+			//Rows added after this belong to the given island
+			void SetIsland(int island) {
+				currentIsland = island < 0 ? 0 : island;
+				islandCount = currentIsland >= islandCount ? currentIsland + 1 : islandCount;
+			}
+
+			void AddVelocityRow(int a, int b, const Vector3& normal, const Vector3& localA, const Vector3& localB,
+				float bias, float lowerLimit, float upperLimit, float* accumulated = nullptr);
+
+			void AddPositionRow(int a, int b, const Vector3& normal, float error, bool oneSided);
+
+			void Solve(int velocityIterations, int positionIterations, WorkerPool* pool = nullptr);
+
+			const SolverBody& GetBody(int index) const {
+				return bodies[index];
+			}
+
+			int GetBodyCount() const {
+				return (int)bodies.size();
+			}
+
+			int GetRowCount() const {
+				return (int)velocityRows.size();
+			}
+
+		protected:
+			void GroupByIsland();
+			void SolveIsland(int island, int velocityIterations, int positionIterations);
+
+			void BuildChains();
+			void PrepareChain(int island);
+			void SolveChainVelocities(int island);
+
+			void ColourIsland(int island);
+			void SolveColouredIsland(const ColouredIsland& coloured, int velocityIterations, int positionIterations, WorkerPool* pool);
+
+			void WarmStart(int first, int last);
+			void SolveVelocities(int first, int last);
+			void SolvePositions(int first, int last);
+			void StoreResults();
+
+			std::vector<SolverBody>		bodies;
+			std::vector<VelocityRow>	velocityRows;
+			std::vector<PositionRow>	positionRows;
+
+			int currentIsland;
+			int islandCount;
+
+			//Where each island's rows start, once they've been grouped together
+			std::vector<int>			velocityStarts;
+			std::vector<int>			positionStarts;
+			std::vector<VelocityRow>	sortedVelocityRows;
+			std::vector<PositionRow>	sortedPositionRows;
+
+			std::vector<bool>			islandColoured;
+			std::vector<ColouredIsland>	colouredIslands;
+			std::vector<ColourBatch>	velocityBatches;
+			std::vector<ColourBatch>	positionBatches;
+			std::vector<uint64_t>		bodyColours;	//a bit for each batch a body is already in
+
+			int							twoSidedRowCount;
+			int							chainCount;
+			std::vector<int>			islandChains;	//-1 for islands without any chains
+			std::vector<IslandChain>	chains;			//only the first chainCount are in use
+		};
+	}
+}
@@ -0,0 +1,58 @@
+#include "ContactManifold.h"
+
+using namespace NCL;
+using namespace CSC8503;
+
+//How close a new contact point has to be to an old one to be treated as the same point
+const float ContactManifold::matchDistance	= 0.1f;
+const float ContactManifold::matchNormal	= 0.95f;
+
+ContactManifold::ContactManifold() {
+	a			= nullptr;
+	b			= nullptr;
+	pointCount	= 0;
+	lastUpdate	= -1;
+}
+
+/*
+Points are matched up in the model space of object A, so that a resting
+object that has rotated slightly still keeps its impulses. If the objects
+have come back from the narrowphase the other way around, the old normals
+point the wrong way, so nothing is carried over.
+*/
+void ContactManifold::Update(const CollisionDetection::CollisionInfo& info, int substep) {
+	ManifoldPoint oldPoints[CollisionDetection::MAX_CONTACT_POINTS];
+	int oldCount = (info.a == a && info.b == b) ? pointCount : 0;
+	for (int i = 0; i < oldCount; ++i) {
+		oldPoints[i] = points[i];
+	}
+
+	a			= info.a;
+	b			= info.b;
+	lastUpdate	= substep;
+	pointCount	= info.pointCount;
+
+	Quaternion toModelA = a->GetTransform().GetOrientation().Conjugate();
+
+	for (int i = 0; i < pointCount; ++i) {
+		const CollisionDetection::ContactPoint& c = info.points[i];
+		ManifoldPoint& p = points[i];
+
+		p.localA		= c.localA;
+		p.localB		= c.localB;
+		p.anchorA		= toModelA * c.localA;
+		p.normal		= c.normal;
+		p.penetration	= c.penetration;
+		p.normalImpulse = 0.0f;
+
+		for (int j = 0; j < oldCount; ++j) {
+			if ((oldPoints[j].anchorA - p.anchorA).Length() < matchDistance &&
+				Vector3::Dot(oldPoints[j].normal, p.normal) > matchNormal) {
+				p.normalImpulse = oldPoints[j].normalImpulse;
+				oldCount--;
+				oldPoints[j] = oldPoints[oldCount]; //each old point can only be matched once
+				break;
+			}
+		}
+	}
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include "CollisionDetection.h"
+
+namespace NCL {
+	namespace CSC8503 {
+		struct ManifoldPoint {
+			Vector3 localA;		//contact point relative to the centre of each object
+			Vector3 localB;
+			Vector3 anchorA;	//localA in A's model space, used to match points between substeps
+			Vector3 normal;
+			float	penetration;
+
+			float	normalImpulse;	//accumulated over every solver iteration, and kept for warm starting
+		};
+
+		/*
+		The contact points between a pair of objects, kept from one substep to
+		the next. Each substep the points are replaced by the ones found by the
+		narrowphase, but any new point that lines up with a point from the
+		previous substep takes on the impulse that was accumulated for it. The
+		solver can then start from last substep's answer (warm starting) rather
+		than from nothing, so resting contacts need far fewer iterations.
+		*/
+		class ContactManifold	{
+		public:
+			ContactManifold();
+			~ContactManifold() {}
+
+			void Update(const CollisionDetection::CollisionInfo& info, int substep);
+
+			GameObject*		a;
+			GameObject*		b;
+			ManifoldPoint	points[CollisionDetection::MAX_CONTACT_POINTS];
+			int				pointCount;
+			int				lastUpdate; //the substep this pair was last seen colliding
+
+		protected:
+			static const float matchDistance;
+			static const float matchNormal;
+		};
+	}
+}
@@ -0,0 +1,592 @@
+#include "GJKAlgorithm.h"
+#include "Transform.h"
+#include "AABBVolume.h"
+#include "OBBVolume.h"
+#include "SphereVolume.h"
+#include "CapsuleVolume.h"
+#include <cfloat>
+#include <cmath>
+
+using namespace NCL;
+using namespace CSC8503;
+
+namespace {
+	const int	maxIterations		= 32;
+	const int	maxPolytopeVertices = 64;
+	const int	maxPolytopeFaces	= maxPolytopeVertices * 2;
+
+	const float progressTolerance	= 1e-6f;	//GJK stops once a new point gets it less than this much closer
+	const float overlapTolerance	= 1e-10f;	//squared distances less than this count as touching
+	const float depthTolerance		= 1e-4f;	//EPA stops once the polytope grows by less than this
+
+	struct Shape {
+		VolumeType	type;
+		Vector3		position;
+		Quaternion	orientation;
+		Vector3		halfSizes;	//capsules only use y, for their half height
+		float		radius;		//spheres and capsules have this much added on all round
+	};
+
+	Shape MakeShape(const CollisionVolume& volume, const Transform& worldTransform) {
+		Shape shape;
+		shape.type			= volume.type;
+		shape.position		= worldTransform.GetPosition();
+		shape.orientation	= worldTransform.GetOrientation();
+		shape.radius		= 0.0f;
+
+		switch (volume.type) {
+			case VolumeType::AABB:
+				shape.halfSizes = ((const AABBVolume&)volume).GetHalfDimensions();
+				break;
+			case VolumeType::OBB:
+				shape.halfSizes = ((const OBBVolume&)volume).GetHalfDimensions();
+				break;
+			case VolumeType::Sphere:
+				shape.radius = ((const SphereVolume&)volume).GetRadius();
+				break;
+			case VolumeType::Capsule:
+				shape.halfSizes = Vector3(0, ((const CapsuleVolume&)volume).GetHalfHeight(), 0);
+				shape.radius	= ((const CapsuleVolume&)volume).GetRadius();
+				break;
+		}
+		return shape;
+	}
+
+	Vector3 SignedSizes(const Vector3& halfSizes, const Vector3& direction) {
+		return Vector3(
+			direction.x >= 0.0f ? halfSizes.x : -halfSizes.x,
+			direction.y >= 0.0f ? halfSizes.y : -halfSizes.y,
+			direction.z >= 0.0f ? halfSizes.z : -halfSizes.z
+		);
+	}
+
+	//Capsules stand upright, as they do everywhere else
+	Vector3 CoreSupport(const Shape& shape, const Vector3& direction) {
+		switch (shape.type) {
+			case VolumeType::AABB:
+			case VolumeType::Capsule:
+				return shape.position + SignedSizes(shape.halfSizes, direction);
+			case VolumeType::OBB: {
+				Vector3 localDirection = shape.orientation.Conjugate() * direction;
+				return shape.position + shape.orientation * SignedSizes(shape.halfSizes, localDirection);
+			}
+		}
+		return shape.position;
+	}
+
+	Vector3 ShapeSupport(const Shape& shape, const Vector3& direction, bool rounded) {
+		Vector3 point = CoreSupport(shape, direction);
+		if (rounded && shape.radius > 0.0f) {
+			float length = direction.Length();
+			if (length > 0.0f) {
+				point = point + direction * (shape.radius / length);
+			}
+		}
+		return point;
+	}
+
+	//A point of the Minkowski difference, along with the points of each shape that made it
+	struct Vertex {
+		Vector3 w;
+		Vector3 a;
+		Vector3 b;
+		Vector3 direction;
+	};
+
+	Vertex MakeVertex(const Shape& shapeA, const Shape& shapeB, const Vector3& direction, bool rounded) {
+		Vertex v;
+		v.direction = direction;
+		v.a = ShapeSupport(shapeA, direction, rounded);
+		v.b = ShapeSupport(shapeB, -direction, rounded);
+		v.w = v.a - v.b;
+		return v;
+	}
+
+	struct Simplex {
+		Vertex	points[4];
+		float	weights[4];	//how much of each point makes up the closest point to the origin
+		int		count;
+	};
+
+	void Keep(Simplex& s, int i0, float w0) {
+		s.points[0]  = s.points[i0];
+		s.weights[0] = w0;
+		s.count = 1;
+	}
+
+	void Keep(Simplex& s, int i0, float w0, int i1, float w1) {
+		Vertex p0 = s.points[i0];
+		Vertex p1 = s.points[i1];
+		s.points[0] = p0;
+		s.points[1] = p1;
+		s.weights[0] = w0;
+		s.weights[1] = w1;
+		s.count = 2;
+	}
+
+	void ClosestOnSegment(Simplex& s) {
+		Vector3 a	= s.points[0].w;
+		Vector3 ab	= s.points[1].w - a;
+		float	length = Vector3::Dot(ab, ab);
+		float	t	= length > 0.0f ? -Vector3::Dot(a, ab) / length : 0.0f;
+
+		if (t <= 0.0f) {
+			Keep(s, 0, 1.0f);
+		}
+		else if (t >= 1.0f) {
+			Keep(s, 1, 1.0f);
+		}
+		else {
+			s.weights[0] = 1.0f - t;
+			s.weights[1] = t;
+		}
+	}
+
+	/*
+	The closest point of a triangle to the origin, found by working out which
+	of its corners, edges, or face the origin is nearest to, from Real-Time
+	Collision Detection (Ericson). Returns the squared distance to it.
+	*/
+	float ClosestOnTriangle(const Vertex& p0, const Vertex& p1, const Vertex& p2, Simplex& out) {
+		Vector3 a = p0.w;
+		Vector3 b = p1.w;
+		Vector3 c = p2.w;
+		Vector3 ab = b - a;
+		Vector3 ac = c - a;
+
+		out.points[0] = p0;
+		out.points[1] = p1;
+		out.points[2] = p2;
+		out.count = 3;
+
+		float d1 = -Vector3::Dot(ab, a);
+		float d2 = -Vector3::Dot(ac, a);
+		if (d1 <= 0.0f && d2 <= 0.0f) {
+			Keep(out, 0, 1.0f);
+			return Vector3::Dot(a, a);
+		}
+
+		float d3 = -Vector3::Dot(ab, b);
+		float d4 = -Vector3::Dot(ac, b);
+		if (d3 >= 0.0f && d4 <= d3) {
+			Keep(out, 1, 1.0f);
+			return Vector3::Dot(b, b);
+		}
+
+		float vc = d1 * d4 - d3 * d2;
+		if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f) {
+			float t = d1 / (d1 - d3);
+			Keep(out, 0, 1.0f - t, 1, t);
+			Vector3 p = a + ab * t;
+			return Vector3::Dot(p, p);
+		}
+
+		float d5 = -Vector3::Dot(ab, c);
+		float d6 = -Vector3::Dot(ac, c);
+		if (d6 >= 0.0f && d5 <= d6) {
+			Keep(out, 2, 1.0f);
+			return Vector3::Dot(c, c);
+		}
+
+		float vb = d5 * d2 - d1 * d6;
+		if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f) {
+			float t = d2 / (d2 - d6);
+			Keep(out, 0, 1.0f - t, 2, t);
+			Vector3 p = a + ac * t;
+			return Vector3::Dot(p, p);
+		}
+
+		float va = d3 * d6 - d5 * d4;
+		if (va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f) {
+			float t = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+			Keep(out, 1, 1.0f - t, 2, t);
+			Vector3 p = b + (c - b) * t;
+			return Vector3::Dot(p, p);
+		}
+
+		float total = va + vb + vc;
+		if (total <= 0.0f) {
+			//A flat triangle - one of its edges will do
+			Keep(out, 0, 1.0f);
+			return Vector3::Dot(a, a);
+		}
+		float v = vb / total;
+		float w = vc / total;
+		out.weights[0] = 1.0f - v - w;
+		out.weights[1] = v;
+		out.weights[2] = w;
+		Vector3 p = a + ab * v + ac * w;
+		return Vector3::Dot(p, p);
+	}
+
+	//Whether the origin is on the other side of face abc to the point d
+	bool OriginOutside(const Vector3& a, const Vector3& b, const Vector3& c, const Vector3& d) {
+		Vector3 normal = Vector3::Cross(b - a, c - a);
+		float	origin = -Vector3::Dot(normal, a);
+		float	other = Vector3::Dot(normal, d - a);
+		return other == 0.0f || origin * other < 0.0f;
+	}
+
+	/*
+	Reduces the simplex down to just the points needed for its closest point
+	to the origin, and works out that point. Returns false if the simplex is
+	a tetrahedron with the origin inside it.
+	*/
+	bool Reduce(Simplex& s, Vector3& closest) {
+		if (s.count == 2) {
+			ClosestOnSegment(s);
+		}
+		else if (s.count == 3) {
+			Simplex reduced;
+			ClosestOnTriangle(s.points[0], s.points[1], s.points[2], reduced);
+			s = reduced;
+		}
+		else if (s.count == 4) {
+			static const int faces[4][4] = {
+				{ 0, 1, 2, 3 }, { 0, 3, 1, 2 }, { 0, 2, 3, 1 }, { 1, 3, 2, 0 }
+			};
+			float	bestDistance = FLT_MAX;
+			Simplex best;
+			for (const int* f : faces) {
+				const Vertex& a = s.points[f[0]];
+				const Vertex& b = s.points[f[1]];
+				const Vertex& c = s.points[f[2]];
+				if (!OriginOutside(a.w, b.w, c.w, s.points[f[3]].w)) {
+					continue;
+				}
+				Simplex reduced;
+				float distance = ClosestOnTriangle(a, b, c, reduced);
+				if (distance < bestDistance) {
+					bestDistance = distance;
+					best = reduced;
+				}
+			}
+			if (bestDistance == FLT_MAX) {
+				return false;
+			}
+			s = best;
+		}
+		else {
+			s.weights[0] = 1.0f;
+		}
+
+		closest = Vector3();
+		for (int i = 0; i < s.count; ++i) {
+			closest = closest + s.points[i].w * s.weights[i];
+		}
+		return true;
+	}
+
+	bool AddPoint(Simplex& s, const Vertex& v) {
+		for (int i = 0; i < s.count; ++i) {
+			if ((s.points[i].w - v.w).LengthSquared() < overlapTolerance) {
+				return false;
+			}
+		}
+		s.points[s.count++] = v;
+		return true;
+	}
+
+	/*
+	Returns true if the shapes overlap, leaving a simplex around the origin.
+	Otherwise, the simplex is left holding the closest points, and closest
+	is the closest point of the Minkowski difference to the origin.
+	*/
+	bool ClosestPoints(const Shape& shapeA, const Shape& shapeB, bool rounded, Simplex& s, Vector3& closest, GJKSimplex* warmStart) {
+		s.count = 0;
+		if (warmStart) {
+			for (int i = 0; i < warmStart->count; ++i) {
+				AddPoint(s, MakeVertex(shapeA, shapeB, warmStart->directions[i], rounded));
+			}
+		}
+		if (s.count == 0) {
+			Vector3 direction = shapeA.position - shapeB.position;
+			if (direction.LengthSquared() == 0.0f) {
+				direction = Vector3(1, 0, 0);
+			}
+			AddPoint(s, MakeVertex(shapeA, shapeB, direction, rounded));
+		}
+
+		bool overlap = false;
+		for (int i = 0; i < maxIterations; ++i) {
+			if (!Reduce(s, closest)) {
+				overlap = true;
+				break;
+			}
+			float distance = Vector3::Dot(closest, closest);
+			if (distance < overlapTolerance) {
+				overlap = true;
+				break;
+			}
+			Vertex v = MakeVertex(shapeA, shapeB, -closest, rounded);
+			if (distance - Vector3::Dot(closest, v.w) <= distance * progressTolerance) {
+				break;
+			}
+			if (!AddPoint(s, v)) {
+				break;
+			}
+		}
+
+		if (warmStart) {
+			warmStart->count = s.count;
+			for (int i = 0; i < s.count; ++i) {
+				warmStart->directions[i] = s.points[i].direction;
+			}
+		}
+		return overlap;
+	}
+
+	/*
+	EPA needs a tetrahedron to start from, but GJK can stop with fewer points
+	if the origin is right on the simplex. It's built up by searching in
+	directions away from the points so far, until it has some volume.
+	*/
+	bool FillTetrahedron(const Shape& shapeA, const Shape& shapeB, Simplex& s) {
+		static const Vector3 axes[6] = {
+			Vector3(1, 0, 0), Vector3(-1, 0, 0), Vector3(0, 1, 0), Vector3(0, -1, 0), Vector3(0, 0, 1), Vector3(0, 0, -1)
+		};
+
+		if (s.count == 1) {
+			for (const Vector3& axis : axes) {
+				if (AddPoint(s, MakeVertex(shapeA, shapeB, axis, true))) {
+					break;
+				}
+			}
+		}
+		if (s.count == 2) {
+			Vector3 line = s.points[1].w - s.points[0].w;
+			for (const Vector3& axis : axes) {
+				Vector3 direction = Vector3::Cross(line, axis);
+				if (direction.LengthSquared() < overlapTolerance) {
+					continue;
+				}
+				Vertex v = MakeVertex(shapeA, shapeB, direction, true);
+				if (Vector3::Cross(v.w - s.points[0].w, line).LengthSquared() > overlapTolerance) {
+					AddPoint(s, v);
+					break;
+				}
+			}
+		}
+		if (s.count == 3) {
+			Vector3 normal = Vector3::Cross(s.points[1].w - s.points[0].w, s.points[2].w - s.points[0].w);
+			for (int i = 0; i < 2 && s.count == 3; ++i) {
+				Vertex v = MakeVertex(shapeA, shapeB, i == 0 ? normal : -normal, true);
+				if (fabs(Vector3::Dot(v.w - s.points[0].w, normal)) > overlapTolerance) {
+					AddPoint(s, v);
+				}
+			}
+		}
+		return s.count == 4;
+	}
+
+	struct Face {
+		int		v[3];
+		Vector3 normal;
+		float	distance;
+	};
+
+	Face MakeFace(const Vertex* vertices, int a, int b, int c) {
+		Face face;
+		face.v[0] = a;
+		face.v[1] = b;
+		face.v[2] = c;
+
+		Vector3 normal = Vector3::Cross(vertices[b].w - vertices[a].w, vertices[c].w - vertices[a].w);
+		float	length = normal.Length();
+		if (length > 0.0f) {
+			face.normal		= normal / length;
+			face.distance	= Vector3::Dot(face.normal, vertices[a].w);
+		}
+		else {
+			face.normal		= Vector3();
+			face.distance	= FLT_MAX;	//never the closest, and never seen from anywhere
+		}
+		return face;
+	}
+
+	/*
+	Grows the polytope out towards the face closest to the origin, until it
+	can't get any further. Each new point replaces the faces it can see, with
+	new faces joining it to the edge of the hole they leave.
+	*/
+	bool ExpandPolytope(const Shape& shapeA, const Shape& shapeB, const Simplex& s, GJKContact& contact) {
+		Vertex	vertices[maxPolytopeVertices];
+		Face	faces[maxPolytopeFaces];
+		int		edges[maxPolytopeFaces * 3][2];
+		int		vertexCount = 4;
+		int		faceCount	= 0;
+
+		for (int i = 0; i < 4; ++i) {
+			vertices[i] = s.points[i];
+		}
+		//Faces are wound so their normals point away from the 4th point
+		static const int tetrahedron[4][4] = {
+			{ 0, 1, 2, 3 }, { 0, 3, 1, 2 }, { 0, 2, 3, 1 }, { 1, 3, 2, 0 }
+		};
+		for (const int* t : tetrahedron) {
+			Face face = MakeFace(vertices, t[0], t[1], t[2]);
+			if (Vector3::Dot(face.normal, vertices[t[3]].w - vertices[t[0]].w) > 0.0f) {
+				face = MakeFace(vertices, t[0], t[2], t[1]);
+			}
+			faces[faceCount++] = face;
+		}
+
+		//A copy, as the faces it was in can be removed before we find we can't go any further
+		Face best;
+		for (;;) {
+			int closest = 0;
+			for (int i = 1; i < faceCount; ++i) {
+				if (faces[i].distance < faces[closest].distance) {
+					closest = i;
+				}
+			}
+			best = faces[closest];
+			if (best.distance == FLT_MAX) {
+				return false;
+			}
+			if (vertexCount == maxPolytopeVertices) {
+				break;
+			}
+			Vertex v = MakeVertex(shapeA, shapeB, best.normal, true);
+			if (Vector3::Dot(v.w, best.normal) - best.distance < depthTolerance) {
+				break;
+			}
+
+			int edgeCount = 0;
+			for (int i = 0; i < faceCount; ) {
+				Face& face = faces[i];
+				if (Vector3::Dot(face.normal, v.w - vertices[face.v[0]].w) <= 0.0f) {
+					++i;
+					continue;
+				}
+				//Edges shared by two removed faces are inside the hole, so cancel out
+				for (int e = 0; e < 3; ++e) {
+					int from	= face.v[e];
+					int to		= face.v[(e + 1) % 3];
+					bool shared = false;
+					for (int j = 0; j < edgeCount; ++j) {
+						if (edges[j][0] == to && edges[j][1] == from) {
+							edges[j][0] = edges[edgeCount - 1][0];
+							edges[j][1] = edges[edgeCount - 1][1];
+							--edgeCount;
+							shared = true;
+							break;
+						}
+					}
+					if (!shared) {
+						edges[edgeCount][0] = from;
+						edges[edgeCount][1] = to;
+						++edgeCount;
+					}
+				}
+				face = faces[--faceCount];
+			}
+
+			if (faceCount + edgeCount > maxPolytopeFaces) {
+				break;
+			}
+			vertices[vertexCount] = v;
+			for (int i = 0; i < edgeCount; ++i) {
+				faces[faceCount++] = MakeFace(vertices, edges[i][0], edges[i][1], vertexCount);
+			}
+			++vertexCount;
+		}
+
+		/*
+		The closest point on the closest face is made of the same amounts of
+		its corners as the points on each shape are.
+		*/
+		const Face& face = best;
+		const Vertex& a = vertices[face.v[0]];
+		const Vertex& b = vertices[face.v[1]];
+		const Vertex& c = vertices[face.v[2]];
+
+		Vector3 point	= face.normal * face.distance;
+		Vector3 ab		= b.w - a.w;
+		Vector3 ac		= c.w - a.w;
+		Vector3 ap		= point - a.w;
+		float d00 = Vector3::Dot(ab, ab);
+		float d01 = Vector3::Dot(ab, ac);
+		float d11 = Vector3::Dot(ac, ac);
+		float d20 = Vector3::Dot(ap, ab);
+		float d21 = Vector3::Dot(ap, ac);
+		float denominator = d00 * d11 - d01 * d01;
+
+		float u = 1.0f, v = 0.0f, w = 0.0f;
+		if (denominator > 0.0f) {
+			v = (d11 * d20 - d01 * d21) / denominator;
+			w = (d00 * d21 - d01 * d20) / denominator;
+			u = 1.0f - v - w;
+		}
+
+		contact.pointA		= a.a * u + b.a * v + c.a * w;
+		contact.pointB		= a.b * u + b.b * v + c.b * w;
+		contact.normal		= face.normal;
+		contact.penetration = face.distance;
+		return true;
+	}
+}
+
+Vector3 GJKAlgorithm::Support(const CollisionVolume& volume, const Transform& worldTransform, const Vector3& direction) {
+	return ShapeSupport(MakeShape(volume, worldTransform), direction, true);
+}
+
+bool GJKAlgorithm::Overlaps(const CollisionVolume& volumeA, const Transform& worldTransformA,
+	const CollisionVolume& volumeB, const Transform& worldTransformB) {
+	Shape shapeA = MakeShape(volumeA, worldTransformA);
+	Shape shapeB = MakeShape(volumeB, worldTransformB);
+
+	Simplex s;
+	Vector3 closest;
+	if (ClosestPoints(shapeA, shapeB, false, s, closest, nullptr)) {
+		return true;
+	}
+	return closest.Length() < shapeA.radius + shapeB.radius;
+}
+
+bool GJKAlgorithm::Intersection(const CollisionVolume& volumeA, const Transform& worldTransformA,
+	const CollisionVolume& volumeB, const Transform& worldTransformB, GJKContact& contact, GJKSimplex* simplex, float margin) {
+	Shape shapeA = MakeShape(volumeA, worldTransformA);
+	Shape shapeB = MakeShape(volumeB, worldTransformB);
+
+	Simplex s;
+	Vector3 closest;
+	GJKSimplex coreSimplex = simplex ? *simplex : GJKSimplex();
+
+	if (!ClosestPoints(shapeA, shapeB, false, s, closest, &coreSimplex)) {
+		if (simplex) {
+			*simplex = coreSimplex;
+		}
+		//The cores are apart, so only their radii (or the margin) can be touching
+		float distance	= closest.Length();
+		float radii		= shapeA.radius + shapeB.radius;
+		if (distance >= radii + margin) {
+			return false;
+		}
+		Vector3 coreA, coreB;
+		for (int i = 0; i < s.count; ++i) {
+			coreA = coreA + s.points[i].a * s.weights[i];
+			coreB = coreB + s.points[i].b * s.weights[i];
+		}
+		contact.normal		= -closest / distance;
+		contact.pointA		= coreA + contact.normal * shapeA.radius;
+		contact.pointB		= coreB - contact.normal * shapeB.radius;
+		contact.penetration = radii - distance;
+		return true;
+	}
+	if (simplex) {
+		*simplex = coreSimplex;
+	}
+
+	//With radii to add on, the simplex has to be found again around the whole shapes
+	if (shapeA.radius > 0.0f || shapeB.radius > 0.0f) {
+		GJKSimplex roundedSimplex = coreSimplex;
+		if (!ClosestPoints(shapeA, shapeB, true, s, closest, &roundedSimplex)) {
+			return false;
+		}
+	}
+	if (!FillTetrahedron(shapeA, shapeB, s)) {
+		return false;
+	}
+	return ExpandPolytope(shapeA, shapeB, s, contact);
+}
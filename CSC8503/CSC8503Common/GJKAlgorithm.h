@@ -0,0 +1,66 @@
+#pragma once
+#include "../../Common/Vector3.h"
+
+namespace NCL {
+	class CollisionVolume;
+	using namespace NCL::Maths;
+
+	namespace CSC8503 {
+		class Transform;
+
+		/*
+		The directions that the points of the last simplex were found in. Shapes
+		don't move far between substeps, so looking in the same directions again
+		gives a simplex that's already almost right, and a pair that's tested
+		every substep only takes an iteration or two to settle.
+		*/
+		struct GJKSimplex {
+			Vector3 directions[4];
+			int		count = 0;
+		};
+
+		struct GJKContact {
+			Vector3 pointA;		//the deepest point of each shape, in world space
+			Vector3 pointB;
+			Vector3 normal;		//from A towards B
+			float	penetration;
+		};
+
+		/*
+		Collision detection between any two convex shapes, using nothing but
+		their support functions - the point of a shape furthest along a given
+		direction.
+
+		GJK finds the closest points of two shapes by building a simplex inside
+		their Minkowski difference (A - B) that gets closer and closer to the
+		origin. If it manages to surround the origin instead, the shapes overlap,
+		and EPA then grows that simplex out into a polytope until it finds the
+		face of the Minkowski difference closest to the origin, which gives the
+		penetration depth and normal.
+
+		Spheres and capsules are treated as a point or line with a radius around
+		it. GJK is run on just the point or line first, which gives an exact
+		answer for shallow contacts, and EPA is only needed if they overlap too.
+		*/
+		class GJKAlgorithm	{
+		public:
+			/*
+			The simplex, if given, is used as a starting point and is replaced by the new one.
+			Shapes less than margin apart are reported as touching too, with a negative
+			penetration of however far apart they are.
+			*/
+			static bool Intersection(const CollisionVolume& volumeA, const Transform& worldTransformA,
+				const CollisionVolume& volumeB, const Transform& worldTransformB, GJKContact& contact, GJKSimplex* simplex = nullptr, float margin = 0.0f);
+
+			//Only whether the shapes are touching, which is just GJK, without EPA
+			static bool Overlaps(const CollisionVolume& volumeA, const Transform& worldTransformA,
+				const CollisionVolume& volumeB, const Transform& worldTransformB);
+
+			static Vector3 Support(const CollisionVolume& volume, const Transform& worldTransform, const Vector3& direction);
+
+		private:
+			GJKAlgorithm()	{}
+			~GJKAlgorithm()	{}
+		};
+	}
+}
@@ -10,6 +10,7 @@ GameObject::GameObject(string objectName)	{
 	boundingVolume	= nullptr;
 	physicsObject	= nullptr;
 	renderObject	= nullptr;
+	SetCollisionLayer(CollisionLayer::Default);
 }
 
 GameObject::~GameObject()	{
@@ -44,4 +45,9 @@ void GameObject::UpdateBroadphaseAABB() {
 		Vector3 halfSizes = ((OBBVolume&)*boundingVolume).GetHalfDimensions();
 		broadphaseAABB = mat * halfSizes;
 	}
+	else if (boundingVolume->type == VolumeType::Capsule) {
+		const CapsuleVolume& capsule = (CapsuleVolume&)*boundingVolume;
+		float r = capsule.GetRadius();
+		broadphaseAABB = Vector3(r, capsule.GetHalfHeight() + r, r);
+	}
 }
\ No newline at end of file
@@ -3,17 +3,13 @@
 #include "CollisionVolume.h"
 #include "PhysicsObject.h"
 #include "RenderObject.h"
+#include "CollisionLayers.h"
 #include <vector>
 
 using std::vector;
 
 namespace NCL {
 	namespace CSC8503 {
-		enum class Layers {
-			LAYER_1 = 1 << 0,
-			LAYER_2 = 1 << 1,
-			LAYER_3 = 1 << 2
-		};
 		class GameObject	{
 		public:
 			GameObject(string name = "");
@@ -27,12 +23,23 @@ namespace NCL {
 				return boundingVolume;
 			}
 
-			vector<Layers>* GetLayers() const {
-				return layers;
+			//Takes the layer's mask from the CollisionLayerMatrix as it is now
+			void SetCollisionLayer(CollisionLayer layer) {
+				collisionCategory	= CollisionLayerMatrix::GetCategory(layer);
+				collisionMask		= CollisionLayerMatrix::Get().GetMask(layer);
+			}
+
+			//The layers this object collides with, as a bit for each layer
+			void SetCollisionMask(uint32_t mask) {
+				collisionMask = mask;
 			}
 
-			void SetLayers(vector<Layers>*& layers) {
-				this->layers = layers;
+			uint32_t GetCollisionCategory() const {
+				return collisionCategory;
+			}
+
+			uint32_t GetCollisionMask() const {
+				return collisionMask;
 			}
 
 			bool IsActive() const {
@@ -79,6 +86,11 @@ namespace NCL {
 
 			void UpdateBroadphaseAABB();
 
+			//Grows the broadphase AABB to cover wherever the object could move to
+			void ExpandBroadphaseAABB(const Vector3& amount) {
+				broadphaseAABB += amount;
+			}
+
 			void SetWorldID(int newID) {
 				worldID = newID;
 			}
@@ -95,7 +107,8 @@ namespace NCL {
 			PhysicsObject*		physicsObject;
 			RenderObject*		renderObject;
 
-			vector<Layers>* layers;
+			uint32_t collisionCategory;
+			uint32_t collisionMask;
 			bool	isActive;
 			int		worldID;
 			string	name;
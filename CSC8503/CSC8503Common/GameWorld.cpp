@@ -68,6 +68,27 @@ void GameWorld::UpdateWorld(float dt) {
 	if (shuffleConstraints) {
 		std::random_shuffle(constraints.begin(), constraints.end());
 	}
+
+	UpdateTransforms();
+}
+
+/*
+Objects can be moved many times in a frame, so their matrices are left
+until the world is about to be drawn, and are then all rebuilt together.
+Anything that hasn't moved is left alone. Objects with physics are drawn
+blended between the last two substeps, from their PhysicsObject, so their
+matrices are skipped too, and only built if something else asks for them.
+*/
+void GameWorld::UpdateTransforms() {
+	for (GameObject* o : gameObjects) {
+		if (o->GetPhysicsObject()) {
+			continue;
+		}
+		const Transform& transform = o->GetTransform();
+		if (transform.IsMatrixDirty()) {
+			transform.UpdateMatrix();
+		}
+	}
 }
 
 bool GameWorld::Raycast(Ray& r, RayCollision& closestCollision, bool closestObject) const {
@@ -78,6 +99,9 @@ bool GameWorld::Raycast(Ray& r, RayCollision& closestCollision, bool closestObje
 		if (!i->GetBoundingVolume()) { //objects might not be collideable etc...
 			continue;
 		}
+		if (i->GetPhysicsObject() && i->GetPhysicsObject()->IsSensor()) {
+			continue; //sensors can't be seen
+		}
 		RayCollision thisCollision;
 		if (CollisionDetection::RayIntersection(r, *i, thisCollision)) {
 				
@@ -1,5 +1,6 @@
 #pragma once
 #include <vector>
+#include <climits>
 #include "Ray.h"
 #include "CollisionDetection.h"
 #include "QuadTree.h"
@@ -44,6 +45,9 @@ namespace NCL {
 
 			virtual void UpdateWorld(float dt);
 
+			//Rebuilds the matrix of every object without physics that has moved since the last time
+			void UpdateTransforms();
+
 			void OperateOnContents(GameObjectFunc f);
 
 			void GetObjectIterators(
@@ -0,0 +1,200 @@
+#include "HashGridBroadPhase.h"
+#include "GameObject.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace NCL;
+using namespace CSC8503;
+
+/*
+The bucket count is rounded up to a power of two, so cells can be mapped to
+buckets with a mask. Levels are sorted from finest to coarsest.
+*/
+HashGridBroadPhase::HashGridBroadPhase(const std::vector<float>& cellSizes, int bucketCount) {
+	int buckets = 1;
+	while (buckets < bucketCount) {
+		buckets <<= 1;
+	}
+	bucketMask = buckets - 1;
+
+	std::vector<float> sizes = cellSizes;
+	std::sort(sizes.begin(), sizes.end());
+
+	for (float size : sizes) {
+		Level l;
+		l.cellSize		= size;
+		l.invCellSize	= 1.0f / size;
+		l.proxyCount	= 0;
+		l.buckets.resize(buckets);
+		levels.emplace_back(l);
+	}
+}
+
+HashGridBroadPhase::~HashGridBroadPhase() {
+}
+
+void HashGridBroadPhase::ClearProxies() {
+	proxyPool.clear();
+	freeProxies.clear();
+	oversized.clear();
+	for (Level& l : levels) {
+		l.proxyCount = 0;
+		for (std::vector<int>& b : l.buckets) {
+			b.clear();
+		}
+	}
+}
+
+int HashGridBroadPhase::ChooseLevel(const Vector3& halfSize) const {
+	float size = halfSize.x > halfSize.y ? halfSize.x : halfSize.y;
+	size = 2.0f * (size > halfSize.z ? size : halfSize.z);
+	for (int i = 0; i < (int)levels.size(); ++i) {
+		if (size <= levels[i].cellSize) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+int HashGridBroadPhase::CellBucket(int x, int y, int z) const {
+	unsigned int h = ((unsigned int)x * 73856093u) ^ ((unsigned int)y * 19349663u) ^ ((unsigned int)z * 83492791u);
+	return (int)(h & bucketMask);
+}
+
+int HashGridBroadPhase::AddProxy(GameObject* object, const Vector3& position, const Vector3& halfSize) {
+	int index;
+	if (!freeProxies.empty()) {
+		index = freeProxies.back();
+		freeProxies.pop_back();
+	}
+	else {
+		index = (int)proxyPool.size();
+		proxyPool.emplace_back();
+	}
+	Proxy& p	= proxyPool[index];
+	p.object	= object;
+	p.box		= BoundingBox(position, halfSize);
+	p.level		= ChooseLevel(halfSize);
+	p.bucket	= -1;
+
+	Link(index);
+	return index;
+}
+
+/*
+Most moves don't take an object out of its current cell, in which case
+only its bounding box needs updating.
+*/
+void HashGridBroadPhase::MoveProxy(int handle, const Vector3& position, const Vector3& halfSize) {
+	Proxy& p = proxyPool[handle];
+	p.box = BoundingBox(position, halfSize);
+
+	int level = ChooseLevel(halfSize);
+	if (level == p.level && level >= 0) {
+		const Level& l = levels[level];
+		int bucket = CellBucket((int)floor(position.x * l.invCellSize),
+			(int)floor(position.y * l.invCellSize), (int)floor(position.z * l.invCellSize));
+		if (bucket == p.bucket) {
+			return;
+		}
+	}
+	Unlink(handle);
+	p.level = level;
+	Link(handle);
+}
+
+void HashGridBroadPhase::RemoveProxy(int handle) {
+	Unlink(handle);
+	proxyPool[handle].object = nullptr;
+	freeProxies.emplace_back(handle);
+}
+
+void HashGridBroadPhase::Link(int handle) {
+	Proxy& p = proxyPool[handle];
+	if (p.level < 0) {
+		oversized.emplace_back(handle);
+		return;
+	}
+	const Level& l = levels[p.level];
+	Vector3 centre = (p.box.min + p.box.max) * 0.5f;
+	p.bucket = CellBucket((int)floor(centre.x * l.invCellSize),
+		(int)floor(centre.y * l.invCellSize), (int)floor(centre.z * l.invCellSize));
+	levels[p.level].buckets[p.bucket].emplace_back(handle);
+	levels[p.level].proxyCount++;
+}
+
+void HashGridBroadPhase::Unlink(int handle) {
+	Proxy& p = proxyPool[handle];
+	if (p.level >= 0) {
+		levels[p.level].proxyCount--;
+	}
+	std::vector<int>& list = p.level < 0 ? oversized : levels[p.level].buckets[p.bucket];
+	auto found = std::find(list.begin(), list.end(), handle);
+	if (found != list.end()) {
+		*found = list.back();
+		list.pop_back();
+	}
+	p.bucket = -1;
+}
+
+/*
+Each object checks its own level, and every coarser level. An object on a
+level is no bigger than a cell, so its centre can be at most half a cell
+outside of anything it overlaps - only the cells within half a cell of the
+querying object's box need to be visited. Objects on the same level would
+find each other twice, so only the one with the lower index reports the pair.
+
+Different cells can hash to the same bucket, so a pair can occasionally be
+found more than once - the duplicates are removed when the pairs are sorted.
+*/
+void HashGridBroadPhase::FindPairs(PairBuffer& pairs) {
+	for (int i = 0; i < (int)proxyPool.size(); ++i) {
+		const Proxy& p = proxyPool[i];
+		if (!p.object || p.level < 0) {
+			continue;
+		}
+		for (int level = p.level; level < (int)levels.size(); ++level) {
+			const Level& l = levels[level];
+			if (l.proxyCount == 0) {
+				continue;
+			}
+			float	border	= l.cellSize * 0.5f;
+			Vector3 minCell = (p.box.min - Vector3(border, border, border)) * l.invCellSize;
+			Vector3 maxCell = (p.box.max + Vector3(border, border, border)) * l.invCellSize;
+
+			int x0 = (int)floor(minCell.x), x1 = (int)floor(maxCell.x);
+			int y0 = (int)floor(minCell.y), y1 = (int)floor(maxCell.y);
+			int z0 = (int)floor(minCell.z), z1 = (int)floor(maxCell.z);
+
+			for (int x = x0; x <= x1; ++x) {
+				for (int y = y0; y <= y1; ++y) {
+					for (int z = z0; z <= z1; ++z) {
+						for (int other : l.buckets[CellBucket(x, y, z)]) {
+							if (level == p.level && other <= i) {
+								continue;
+							}
+							if (p.box.Overlaps(proxyPool[other].box) && CanCollide(p.object, proxyPool[other].object)) {
+								pairs.Add(p.object, proxyPool[other].object);
+							}
+						}
+					}
+				}
+			}
+		}
+	}
+
+	for (size_t i = 0; i < oversized.size(); ++i) {
+		const Proxy& p = proxyPool[oversized[i]];
+		for (const Proxy& other : proxyPool) {
+			if (!other.object || &other == &p) {
+				continue;
+			}
+			if (other.level < 0 && &other < &p) {
+				continue; //the other oversized object will report it
+			}
+			if (p.box.Overlaps(other.box) && CanCollide(p.object, other.object)) {
+				pairs.Add(p.object, other.object);
+			}
+		}
+	}
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include "BroadPhaseStructure.h"
+#include "AABBTree.h"
+#include <vector>
+
+namespace NCL {
+	namespace CSC8503 {
+		/*
+		A hierarchical spatial hash grid. Each level is a uniform grid with its
+		own cell size, hashed into a fixed number of buckets, so the grid has no
+		bounds and no memory cost for empty space. Every object is stored once,
+		in the cell containing its centre, on the finest level whose cells are at
+		least as big as the object. Objects bigger than the coarsest level's
+		cells, like the floor, are kept to one side and tested against everything.
+
+		This suits lots of similarly sized objects packed closely together, such
+		as every player spawning at once, which a tree has to keep splitting.
+		*/
+		class HashGridBroadPhase : public BroadPhaseStructure	{
+		public:
+			HashGridBroadPhase(const std::vector<float>& cellSizes = { 4.0f, 16.0f, 64.0f }, int bucketCount = 4096);
+			~HashGridBroadPhase();
+
+			void FindPairs(PairBuffer& pairs) override;
+
+			int GetLevelCount() const {
+				return (int)levels.size();
+			}
+
+		protected:
+			struct Level {
+				float cellSize;
+				float invCellSize;
+				int	  proxyCount;
+				std::vector<std::vector<int>> buckets;
+			};
+
+			struct Proxy {
+				GameObject* object;
+				BoundingBox box;
+				int			level;	//-1 if too big for any level
+				int			bucket;
+			};
+
+			void	ClearProxies() override;
+			int		AddProxy(GameObject* object, const Vector3& position, const Vector3& halfSize) override;
+			void	MoveProxy(int handle, const Vector3& position, const Vector3& halfSize) override;
+			void	RemoveProxy(int handle) override;
+
+			void	Link(int handle);
+			void	Unlink(int handle);
+
+			int		ChooseLevel(const Vector3& halfSize) const;
+			int		CellBucket(int x, int y, int z) const;
+
+			std::vector<Level>	levels;
+			std::vector<int>	oversized;
+			int					bucketMask;
+
+			std::vector<Proxy>	proxyPool;
+			std::vector<int>	freeProxies;
+		};
+	}
+}
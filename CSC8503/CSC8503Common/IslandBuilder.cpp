@@ -0,0 +1,95 @@
+#include "IslandBuilder.h"
+#include "GameObject.h"
+
+using namespace NCL;
+using namespace CSC8503;
+
+IslandBuilder::IslandBuilder() {
+}
+
+IslandBuilder::~IslandBuilder() {
+}
+
+void IslandBuilder::Clear() {
+	bodies.clear();
+	parents.clear();
+	islandBodies.clear();
+	islands.clear();
+}
+
+void IslandBuilder::AddBody(GameObject* object) {
+	object->GetPhysicsObject()->SetIslandIndex((int)bodies.size());
+	parents.emplace_back((int)bodies.size());
+	bodies.emplace_back(object);
+}
+
+/*
+Objects that weren't added (static objects, or those without physics) don't
+connect anything. An object's index is only trusted if it points back at the
+object, as it may have been left over from an earlier build.
+*/
+int IslandBuilder::GetBodyIndex(GameObject* object) const {
+	PhysicsObject* phys = object->GetPhysicsObject();
+	if (!phys) {
+		return -1;
+	}
+	int index = phys->GetIslandIndex();
+	if (index < 0 || index >= (int)bodies.size() || bodies[index] != object) {
+		return -1;
+	}
+	return index;
+}
+
+void IslandBuilder::Connect(GameObject* a, GameObject* b) {
+	int indexA = GetBodyIndex(a);
+	int indexB = GetBodyIndex(b);
+	if (indexA == -1 || indexB == -1) {
+		return;
+	}
+	int rootA = FindRoot(indexA);
+	int rootB = FindRoot(indexB);
+	if (rootA != rootB) {
+		parents[rootB] = rootA;
+	}
+}
+
+int IslandBuilder::FindRoot(int body) {
+	while (parents[body] != body) {
+		parents[body] = parents[parents[body]]; //halve the path on the way up
+		body = parents[body];
+	}
+	return body;
+}
+
+/*
+Once every connection has been made, the bodies are counted up per island,
+and then copied into one array, with each island's bodies next to each other.
+*/
+void IslandBuilder::Build() {
+	islands.clear();
+	rootIslands.assign(bodies.size(), -1);
+
+	for (int i = 0; i < (int)bodies.size(); ++i) {
+		int root = FindRoot(i);
+		if (rootIslands[root] == -1) {
+			rootIslands[root] = (int)islands.size();
+			islands.push_back({ 0, 0 });
+		}
+		islands[rootIslands[root]].bodyCount++;
+	}
+
+	int first = 0;
+	for (Island& island : islands) {
+		island.firstBody = first;
+		first += island.bodyCount;
+		island.bodyCount = 0;
+	}
+
+	islandBodies.resize(bodies.size());
+	bodyIslands.resize(bodies.size());
+	for (int i = 0; i < (int)bodies.size(); ++i) {
+		bodyIslands[i] = rootIslands[FindRoot(i)];
+		Island& island = islands[bodyIslands[i]];
+		islandBodies[island.firstBody + island.bodyCount++] = bodies[i];
+	}
+}
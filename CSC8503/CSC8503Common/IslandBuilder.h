@@ -0,0 +1,62 @@
+#pragma once
+#include <vector>
+
+namespace NCL {
+	namespace CSC8503 {
+		class GameObject;
+
+		struct Island {
+			int firstBody;	//into the builder's island bodies
+			int bodyCount;
+		};
+
+		/*
+		Groups the dynamic objects in the world into islands - sets of objects
+		that are connected to each other through contacts or constraints. Static
+		objects don't join islands together, so two piles of boxes resting on the
+		same floor are still separate islands. Everything in an island is woken
+		up or put to sleep together.
+		*/
+		class IslandBuilder	{
+		public:
+			IslandBuilder();
+			~IslandBuilder();
+
+			void Clear();
+
+			void AddBody(GameObject* object);
+			void Connect(GameObject* a, GameObject* b);
+			void Build();
+
+			int GetIslandCount() const {
+				return (int)islands.size();
+			}
+
+			const Island& GetIsland(int index) const {
+				return islands[index];
+			}
+
+			GameObject* GetIslandBody(int index) const {
+				return islandBodies[index];
+			}
+
+			//Static objects, or anything not added this build, aren't in an island (-1)
+			int GetIslandOf(GameObject* object) const {
+				int index = GetBodyIndex(object);
+				return index == -1 ? -1 : bodyIslands[index];
+			}
+
+		protected:
+			int GetBodyIndex(GameObject* object) const;
+			int FindRoot(int body);
+
+			std::vector<GameObject*>	bodies;
+			std::vector<int>			parents;
+
+			std::vector<GameObject*>	islandBodies; //sorted by island
+			std::vector<Island>			islands;
+			std::vector<int>			rootIslands;
+			std::vector<int>			bodyIslands;
+		};
+	}
+}
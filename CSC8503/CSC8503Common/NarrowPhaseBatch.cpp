@@ -0,0 +1,199 @@
+#include "NarrowPhaseBatch.h"
+#include "GameObject.h"
+#include "AABBVolume.h"
+#include "SphereVolume.h"
+#include "CapsuleVolume.h"
+#include "SimdFloat.h"
+
+using namespace NCL;
+using namespace CSC8503;
+using namespace Simd;
+
+namespace {
+	/*
+	The kernels don't do their sums in quite the same way as the full tests,
+	so they let through anything within a whisker of touching, rather than
+	risk throwing away a pair that ObjectIntersection would have kept.
+	*/
+	const float candidateSlop = 1.001f;
+}
+
+NarrowPhaseBatch::NarrowPhaseBatch() {
+}
+
+NarrowPhaseBatch::~NarrowPhaseBatch() {
+}
+
+void NarrowPhaseBatch::Begin(int slotCount) {
+	outcomes.assign(slotCount, Skipped);
+	for (Bucket& bucket : buckets) {
+		bucket.slots.clear();
+		for (std::vector<float>& lane : bucket.lanes) {
+			lane.clear();
+		}
+	}
+}
+
+/*
+A margin is just added on to the size of one of the shapes, which is never
+any closer than the shapes really are.
+*/
+void NarrowPhaseBatch::AddPair(int slot, GameObject* a, GameObject* b, float margin) {
+	outcomes[slot] = MayTouch;
+
+	const CollisionVolume* volA = a->GetBoundingVolume();
+	const CollisionVolume* volB = b->GetBoundingVolume();
+	if (!volA || !volB) {
+		return;
+	}
+
+	if (volA->type == VolumeType::Sphere && volB->type == VolumeType::Sphere) {
+		float radiusA = ((const SphereVolume&)*volA).GetRadius() + margin;
+		float radiusB = ((const SphereVolume&)*volB).GetRadius();
+		AddToBucket(SphereSphere, slot, a, b, radiusA, 0, 0, radiusB, 0, 0);
+	}
+	else if (volA->type == VolumeType::AABB && volB->type == VolumeType::AABB) {
+		Vector3 sizeA = ((const AABBVolume&)*volA).GetHalfDimensions() + Vector3(margin, margin, margin);
+		Vector3 sizeB = ((const AABBVolume&)*volB).GetHalfDimensions();
+		AddToBucket(AABBAABB, slot, a, b, sizeA.x, sizeA.y, sizeA.z, sizeB.x, sizeB.y, sizeB.z);
+	}
+	else if (volA->type == VolumeType::AABB && volB->type == VolumeType::Sphere) {
+		Vector3 size	= ((const AABBVolume&)*volA).GetHalfDimensions();
+		float	radius	= ((const SphereVolume&)*volB).GetRadius() + margin;
+		AddToBucket(AABBSphere, slot, a, b, size.x, size.y, size.z, radius, 0, 0);
+	}
+	else if (volA->type == VolumeType::Sphere && volB->type == VolumeType::AABB) {
+		Vector3 size	= ((const AABBVolume&)*volB).GetHalfDimensions();
+		float	radius	= ((const SphereVolume&)*volA).GetRadius() + margin;
+		AddToBucket(AABBSphere, slot, b, a, size.x, size.y, size.z, radius, 0, 0);
+	}
+	else if (volA->type == VolumeType::Capsule && volB->type == VolumeType::Capsule) {
+		const CapsuleVolume& capsuleA = (const CapsuleVolume&)*volA;
+		const CapsuleVolume& capsuleB = (const CapsuleVolume&)*volB;
+		AddToBucket(CapsuleCapsule, slot, a, b,
+			capsuleA.GetRadius() + margin, capsuleA.GetHalfHeight(), 0, capsuleB.GetRadius(), capsuleB.GetHalfHeight(), 0);
+	}
+}
+
+void NarrowPhaseBatch::AddToBucket(Kernel kernel, int slot, GameObject* a, GameObject* b,
+	float sizeAX, float sizeAY, float sizeAZ, float sizeBX, float sizeBY, float sizeBZ) {
+	Bucket& bucket = buckets[kernel];
+	Vector3 positionA = a->GetTransform().GetPosition();
+	Vector3 positionB = b->GetTransform().GetPosition();
+
+	bucket.slots.emplace_back(slot);
+	bucket.lanes[PositionAX].emplace_back(positionA.x);
+	bucket.lanes[PositionAY].emplace_back(positionA.y);
+	bucket.lanes[PositionAZ].emplace_back(positionA.z);
+	bucket.lanes[PositionBX].emplace_back(positionB.x);
+	bucket.lanes[PositionBY].emplace_back(positionB.y);
+	bucket.lanes[PositionBZ].emplace_back(positionB.z);
+	bucket.lanes[SizeAX].emplace_back(sizeAX);
+	bucket.lanes[SizeAY].emplace_back(sizeAY);
+	bucket.lanes[SizeAZ].emplace_back(sizeAZ);
+	bucket.lanes[SizeBX].emplace_back(sizeBX);
+	bucket.lanes[SizeBY].emplace_back(sizeBY);
+	bucket.lanes[SizeBZ].emplace_back(sizeBZ);
+}
+
+/*
+Each bucket is padded out with empty pairs to a whole number of SIMD
+registers, so the kernels never need a scalar tail. The padding's
+results are just never looked at.
+*/
+void NarrowPhaseBatch::Run() {
+	for (Bucket& bucket : buckets) {
+		int count	= (int)bucket.slots.size();
+		int padded	= (count + SimdWidth - 1) / SimdWidth * SimdWidth;
+		for (std::vector<float>& lane : bucket.lanes) {
+			lane.resize(padded, 0.0f);
+		}
+	}
+	TestSpheres(buckets[SphereSphere]);
+	TestAABBs(buckets[AABBAABB]);
+	TestAABBSpheres(buckets[AABBSphere]);
+	TestCapsules(buckets[CapsuleCapsule]);
+}
+
+void NarrowPhaseBatch::SetOutcomes(const Bucket& bucket, int first, int touching) {
+	int count = (int)bucket.slots.size() - first;
+	if (count > SimdWidth) {
+		count = SimdWidth;
+	}
+	for (int i = 0; i < count; ++i) {
+		outcomes[bucket.slots[first + i]] = (touching >> i) & 1 ? MayTouch : Separate;
+	}
+}
+
+void NarrowPhaseBatch::TestSpheres(Bucket& bucket) {
+	SimdFloat slop = Splat(candidateSlop);
+
+	for (int i = 0; i < (int)bucket.slots.size(); i += SimdWidth) {
+		SimdFloat dx = Sub(LoadUnaligned(&bucket.lanes[PositionBX][i]), LoadUnaligned(&bucket.lanes[PositionAX][i]));
+		SimdFloat dy = Sub(LoadUnaligned(&bucket.lanes[PositionBY][i]), LoadUnaligned(&bucket.lanes[PositionAY][i]));
+		SimdFloat dz = Sub(LoadUnaligned(&bucket.lanes[PositionBZ][i]), LoadUnaligned(&bucket.lanes[PositionAZ][i]));
+
+		SimdFloat radii = Mul(Add(LoadUnaligned(&bucket.lanes[SizeAX][i]), LoadUnaligned(&bucket.lanes[SizeBX][i])), slop);
+		SimdFloat distance = Add(Add(Mul(dx, dx), Mul(dy, dy)), Mul(dz, dz));
+
+		SetOutcomes(bucket, i, Mask(Less(distance, Mul(radii, radii))));
+	}
+}
+
+void NarrowPhaseBatch::TestAABBs(Bucket& bucket) {
+	SimdFloat slop = Splat(candidateSlop);
+
+	for (int i = 0; i < (int)bucket.slots.size(); i += SimdWidth) {
+		SimdFloat overlap = Splat(0.0f);
+		for (int axis = 0; axis < 3; ++axis) {
+			SimdFloat delta = Sub(LoadUnaligned(&bucket.lanes[PositionBX + axis][i]), LoadUnaligned(&bucket.lanes[PositionAX + axis][i]));
+			SimdFloat total = Mul(Add(LoadUnaligned(&bucket.lanes[SizeAX + axis][i]), LoadUnaligned(&bucket.lanes[SizeBX + axis][i])), slop);
+			SimdFloat inside = Less(Abs(delta), total);
+			overlap = axis == 0 ? inside : And(overlap, inside);
+		}
+		SetOutcomes(bucket, i, Mask(overlap));
+	}
+}
+
+//The box is always A, and the sphere B
+void NarrowPhaseBatch::TestAABBSpheres(Bucket& bucket) {
+	SimdFloat slop = Splat(candidateSlop);
+
+	for (int i = 0; i < (int)bucket.slots.size(); i += SimdWidth) {
+		SimdFloat distance = Splat(0.0f);
+		for (int axis = 0; axis < 3; ++axis) {
+			SimdFloat delta = Sub(LoadUnaligned(&bucket.lanes[PositionBX + axis][i]), LoadUnaligned(&bucket.lanes[PositionAX + axis][i]));
+			SimdFloat size	= LoadUnaligned(&bucket.lanes[SizeAX + axis][i]);
+			SimdFloat outside = Sub(delta, Max(Min(delta, size), Sub(Splat(0.0f), size)));
+			distance = Add(distance, Mul(outside, outside));
+		}
+		SimdFloat radius = Mul(LoadUnaligned(&bucket.lanes[SizeBX][i]), slop);
+
+		SetOutcomes(bucket, i, Mask(Less(distance, Mul(radius, radius))));
+	}
+}
+
+/*
+Capsules always stand upright, so the closest their middle lines can get
+is just the gap between them across the floor, along with however far
+apart the lines are vertically, if they don't overlap. CapsuleIntersection
+never finds points any closer than that.
+*/
+void NarrowPhaseBatch::TestCapsules(Bucket& bucket) {
+	SimdFloat slop = Splat(candidateSlop);
+	SimdFloat zero = Splat(0.0f);
+
+	for (int i = 0; i < (int)bucket.slots.size(); i += SimdWidth) {
+		SimdFloat dx = Sub(LoadUnaligned(&bucket.lanes[PositionBX][i]), LoadUnaligned(&bucket.lanes[PositionAX][i]));
+		SimdFloat dy = Sub(LoadUnaligned(&bucket.lanes[PositionBY][i]), LoadUnaligned(&bucket.lanes[PositionAY][i]));
+		SimdFloat dz = Sub(LoadUnaligned(&bucket.lanes[PositionBZ][i]), LoadUnaligned(&bucket.lanes[PositionAZ][i]));
+
+		SimdFloat heights	= Add(LoadUnaligned(&bucket.lanes[SizeAY][i]), LoadUnaligned(&bucket.lanes[SizeBY][i]));
+		SimdFloat gap		= Max(Sub(Abs(dy), heights), zero);
+		SimdFloat distance	= Add(Add(Mul(dx, dx), Mul(dz, dz)), Mul(gap, gap));
+
+		SimdFloat radii = Mul(Add(LoadUnaligned(&bucket.lanes[SizeAX][i]), LoadUnaligned(&bucket.lanes[SizeBX][i])), slop);
+
+		SetOutcomes(bucket, i, Mask(Less(distance, Mul(radii, radii))));
+	}
+}
@@ -0,0 +1,80 @@
+#pragma once
+#include <vector>
+
+namespace NCL {
+	namespace CSC8503 {
+		class GameObject;
+
+		/*
+		Sorts a block of broadphase pairs into buckets by the shapes involved,
+		copies what each bucket's test needs out into arrays of floats, and
+		then tests several pairs at a time with SIMD kernels. Most broadphase
+		pairs aren't really touching, and these find which ones definitely
+		aren't very cheaply.
+
+		The kernels only decide which pairs need looking at properly - any
+		pair that might be touching still goes through ObjectIntersection,
+		so the CollisionInfo for it is exactly what it would have been.
+		*/
+		class NarrowPhaseBatch	{
+		public:
+			enum Outcome : char {
+				Skipped,	//never added
+				Separate,	//definitely not touching
+				MayTouch	//needs the full intersection test
+			};
+
+			NarrowPhaseBatch();
+			~NarrowPhaseBatch();
+
+			//Every slot starts off Skipped
+			void Begin(int slotCount);
+
+			//Pairs of shapes without a kernel are always MayTouch. Pairs less than
+			//margin apart are MayTouch too, so they can be given speculative contacts
+			void AddPair(int slot, GameObject* a, GameObject* b, float margin = 0.0f);
+
+			void Run();
+
+			Outcome GetOutcome(int slot) const {
+				return outcomes[slot];
+			}
+
+		protected:
+			enum Kernel {
+				SphereSphere,
+				AABBAABB,
+				AABBSphere,
+				CapsuleCapsule,
+				KernelCount
+			};
+
+			//Which arrays each bucket fills in depends on its kernel
+			enum Lane {
+				PositionAX, PositionAY, PositionAZ,
+				PositionBX, PositionBY, PositionBZ,
+				SizeAX, SizeAY, SizeAZ,		//half sizes, or radius and half height
+				SizeBX, SizeBY, SizeBZ,
+				LaneCount
+			};
+
+			struct Bucket {
+				std::vector<int>	slots;
+				std::vector<float>	lanes[LaneCount];
+			};
+
+			void AddToBucket(Kernel kernel, int slot, GameObject* a, GameObject* b,
+				float sizeAX, float sizeAY, float sizeAZ, float sizeBX, float sizeBY, float sizeBZ);
+
+			void SetOutcomes(const Bucket& bucket, int first, int touching);
+
+			void TestSpheres(Bucket& bucket);
+			void TestAABBs(Bucket& bucket);
+			void TestAABBSpheres(Bucket& bucket);
+			void TestCapsules(Bucket& bucket);
+
+			std::vector<Outcome>	outcomes;
+			Bucket					buckets[KernelCount];
+		};
+	}
+}
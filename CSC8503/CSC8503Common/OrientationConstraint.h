@@ -7,17 +7,13 @@ namespace NCL {
 
 		class OrientationConstraint : public Constraint {
 		public:
-			OrientationConstraint(GameObject* a, GameObject* b, Quaternion r) {
-				objectA = a;
-				objectB = b;
+			OrientationConstraint(GameObject* a, GameObject* b, Quaternion r) : Constraint(a, b) {
 				rotation = r;
 			}
 			~OrientationConstraint() {}
 
-			void UpdateConstraint(float dt) override;
+			void AddRows(ConstraintSolver& solver, float dt) override;
 		protected:
-			GameObject* objectA;
-			GameObject* objectB;
 			Quaternion rotation;
 		};
 	}
@@ -0,0 +1,62 @@
+#include "PairBuffer.h"
+#include <algorithm>
+
+using namespace NCL;
+using namespace CSC8503;
+
+/*
+An LSD radix sort, 8 bits at a time. The histograms for every byte are built
+in a single pass over the keys, and any byte that is the same for every key
+(most of the high bits of world IDs, in practice) is skipped entirely. Short
+lists aren't worth the histogram setup, so are just insertion sorted.
+*/
+void PairBuffer::SortAndRemoveDuplicates() {
+	size_t count = pairs.size();
+	if (count < 2) {
+		return;
+	}
+
+	if (count <= 32) {
+		for (size_t i = 1; i < count; ++i) {
+			BroadPhasePair p = pairs[i];
+			size_t j = i;
+			for (; j > 0 && pairs[j - 1].key > p.key; --j) {
+				pairs[j] = pairs[j - 1];
+			}
+			pairs[j] = p;
+		}
+	}
+	else {
+		const int passes = sizeof(PairKey);
+		size_t histogram[passes][256] = {};
+
+		for (const BroadPhasePair& p : pairs) {
+			for (int i = 0; i < passes; ++i) {
+				histogram[i][(p.key >> (i * 8)) & 0xFF]++;
+			}
+		}
+		scratch.resize(count);
+
+		for (int i = 0; i < passes; ++i) {
+			size_t* counts = histogram[i];
+			if (counts[(pairs[0].key >> (i * 8)) & 0xFF] == count) {
+				continue; //every key has the same value for this byte
+			}
+			size_t offset = 0;
+			for (int j = 0; j < 256; ++j) {
+				size_t c	= counts[j];
+				counts[j]	= offset;
+				offset		+= c;
+			}
+			for (const BroadPhasePair& p : pairs) {
+				scratch[counts[(p.key >> (i * 8)) & 0xFF]++] = p;
+			}
+			pairs.swap(scratch);
+		}
+	}
+
+	auto last = std::unique(pairs.begin(), pairs.end(), [](const BroadPhasePair& a, const BroadPhasePair& b) {
+		return a.key == b.key;
+	});
+	pairs.erase(last, pairs.end());
+}
@@ -0,0 +1,81 @@
+#pragma once
+#include "GameObject.h"
+#include <vector>
+#include <cstdint>
+
+namespace NCL {
+	namespace CSC8503 {
+		typedef uint64_t PairKey;
+
+		//Packs the world IDs of both objects into one key, lowest ID first, so
+		//it doesn't matter which way around the objects are given
+		inline PairKey MakePairKey(const GameObject* a, const GameObject* b) {
+			uint32_t idA = (uint32_t)a->GetWorldID();
+			uint32_t idB = (uint32_t)b->GetWorldID();
+			return idA < idB ? ((PairKey)idA << 32) | idB : ((PairKey)idB << 32) | idA;
+		}
+
+		//Broadphases only pass a pair on if each object is on a layer the other collides with
+		inline bool CanCollide(const GameObject* a, const GameObject* b) {
+			return (a->GetCollisionCategory() & b->GetCollisionMask()) && (b->GetCollisionCategory() & a->GetCollisionMask());
+		}
+
+		struct BroadPhasePair {
+			PairKey		key;
+			GameObject* a; //always the object with the lower world ID
+			GameObject* b;
+		};
+
+		/*
+		A flat list of potentially colliding pairs, filled in by the broadphase.
+		Adding a pair is just an append, so the same pair can be added more than
+		once - SortAndRemoveDuplicates sorts the list by key with a radix sort,
+		and strips out any repeats, leaving the pairs in world ID order.
+		*/
+		class PairBuffer	{
+		public:
+			PairBuffer() {}
+			~PairBuffer() {}
+
+			void Clear() {
+				pairs.clear();
+			}
+
+			int Add(GameObject* a, GameObject* b) {
+				if (a->GetWorldID() > b->GetWorldID()) {
+					std::swap(a, b);
+				}
+				pairs.push_back({ MakePairKey(a, b), a, b });
+				return (int)pairs.size() - 1;
+			}
+
+			//Swaps the last pair into the removed pair's place
+			void RemoveAt(int index) {
+				pairs[index] = pairs.back();
+				pairs.pop_back();
+			}
+
+			void SortAndRemoveDuplicates();
+
+			int GetCount() const {
+				return (int)pairs.size();
+			}
+
+			const BroadPhasePair& operator[](int index) const {
+				return pairs[index];
+			}
+
+			std::vector<BroadPhasePair>::const_iterator begin() const {
+				return pairs.begin();
+			}
+
+			std::vector<BroadPhasePair>::const_iterator end() const {
+				return pairs.end();
+			}
+
+		protected:
+			std::vector<BroadPhasePair> pairs;
+			std::vector<BroadPhasePair> scratch;
+		};
+	}
+}
@@ -0,0 +1,149 @@
+#pragma once
+#include "PairBuffer.h"
+#include <vector>
+#include <algorithm>
+
+namespace NCL {
+	namespace CSC8503 {
+		/*
+		Stores something for each pair of objects, such as the collisions that
+		persist across multiple frames. The values themselves live in one
+		contiguous list, which can be walked over in order, while an open
+		addressing hash table (with linear probing) maps each pair key to its
+		position in that list. Removing a value swaps the last one into its
+		place, so the list never has any holes in it.
+
+		Pointers returned by Insert and Find are only valid until the next
+		Insert or RemoveAt.
+		*/
+		template<class T>
+		class PairMap	{
+		public:
+			PairMap(int capacity = 64) {
+				int slotCount = 16;
+				while (slotCount < capacity * 2) {
+					slotCount <<= 1;
+				}
+				Rehash(slotCount);
+			}
+			~PairMap() {}
+
+			void Clear() {
+				values.clear();
+				keys.clear();
+				std::fill(slots.begin(), slots.end(), -1);
+			}
+
+			//Like std::set::insert, an existing value for the pair is left as it is.
+			//Returns the value for the pair, and whether it was just added.
+			std::pair<T*, bool> Insert(PairKey key, const T& value) {
+				int slot = FindSlot(key);
+				if (slots[slot] != -1) {
+					return { &values[slots[slot]], false };
+				}
+				slots[slot] = (int)values.size();
+				values.emplace_back(value);
+				keys.emplace_back(key);
+
+				if (values.size() * 2 > slots.size()) {
+					Rehash((int)slots.size() * 2);
+				}
+				return { &values.back(), true };
+			}
+
+			T* Find(PairKey key) {
+				int slot = FindSlot(key);
+				return slots[slot] == -1 ? nullptr : &values[slots[slot]];
+			}
+
+			/*
+			Linear probing can't just empty a slot, as that would break the probe
+			sequence of any key stored after it. Instead, the entries following the
+			removed slot are shifted back into the gap, if that doesn't move them in
+			front of their home slot. The last value is then moved into the removed
+			value's place in the list, and its slot is updated to match.
+			*/
+			void RemoveAt(int index) {
+				size_t hole = FindSlot(keys[index]);
+				size_t next = (hole + 1) & slotMask;
+
+				while (slots[next] != -1) {
+					size_t home = HashSlot(keys[slots[next]]);
+					if (((next - home) & slotMask) >= ((next - hole) & slotMask)) {
+						slots[hole] = slots[next];
+						hole = next;
+					}
+					next = (next + 1) & slotMask;
+				}
+				slots[hole] = -1;
+
+				int last = (int)values.size() - 1;
+				if (index != last) {
+					values[index]	= values[last];
+					keys[index]		= keys[last];
+					slots[FindSlot(keys[index])] = index;
+				}
+				values.pop_back();
+				keys.pop_back();
+			}
+
+			int GetCount() const {
+				return (int)values.size();
+			}
+
+			PairKey GetKey(int index) const {
+				return keys[index];
+			}
+
+			T& operator[](int index) {
+				return values[index];
+			}
+
+			typename std::vector<T>::iterator begin() {
+				return values.begin();
+			}
+
+			typename std::vector<T>::iterator end() {
+				return values.end();
+			}
+
+			typename std::vector<T>::const_iterator begin() const {
+				return values.begin();
+			}
+
+			typename std::vector<T>::const_iterator end() const {
+				return values.end();
+			}
+
+		protected:
+			//Returns the slot holding the key, or the empty slot where it would go
+			int FindSlot(PairKey key) const {
+				size_t slot = HashSlot(key);
+				while (slots[slot] != -1 && keys[slots[slot]] != key) {
+					slot = (slot + 1) & slotMask;
+				}
+				return (int)slot;
+			}
+
+			//The table is kept at most half full, so that probe sequences stay short
+			void Rehash(int newSlotCount) {
+				slots.assign(newSlotCount, -1);
+				slotMask = newSlotCount - 1;
+				for (int i = 0; i < (int)keys.size(); ++i) {
+					slots[FindSlot(keys[i])] = i;
+				}
+			}
+
+			size_t HashSlot(PairKey key) const {
+				key ^= key >> 31;
+				key *= 0x9E3779B97F4A7C15ull;
+				return (size_t)(key >> 32) & slotMask;
+			}
+
+			std::vector<T>			values;
+			std::vector<PairKey>	keys;	//the key of each value, in the same order
+			std::vector<int>		slots;	//index into values, or -1 if empty
+			size_t					slotMask;
+		};
+	}
+}
@@ -1,52 +1,152 @@
 #include "PhysicsObject.h"
 #include "PhysicsSystem.h"
 #include "../CSC8503Common/Transform.h"
+#include "../../Common/Maths.h"
 using namespace NCL;
 using namespace CSC8503;
 
 PhysicsObject::PhysicsObject(Transform* parentTransform, const CollisionVolume* parentVolume)	{
 	transform	= parentTransform;
 	volume		= parentVolume;
+	bodies		= nullptr;
+	body		= -1;
 
-	inverseMass = 1.0f;
 	elasticity	= 0.8f;
 	friction	= 0.8f;
+	solverIndex	= -1;
+	islandIndex	= -1;
+	asleep		= false;
+	sleepTime	= 0.0f;
+	continuous	= false;
+	sensor		= false;
+	bodyType	= BodyType::Dynamic;
+	inertiaDirty = true;
+
+	for (float& f : localState) {
+		f = 0.0f;
+	}
+	SetInverseMass(1.0f);
 }
 
 PhysicsObject::~PhysicsObject()	{
+	if (bodies) {
+		bodies->RemoveBody(body);
+	}
+}
+
+/*
+Only the state the pool doesn't get from the Transform is carried across,
+which is every component from the linear velocity through to the mass.
+Whether the body is active is worked out by the PhysicsSystem every update.
+*/
+void PhysicsObject::SetBodyPool(RigidBodyPool* pool) {
+	if (pool == bodies) {
+		return;
+	}
+	for (int c = RigidBodyPool::LinearVelocityX; c <= RigidBodyPool::InverseMass; ++c) {
+		localState[c] = GetBodyValue((RigidBodyPool::Component)c);
+	}
+	if (bodies) {
+		bodies->RemoveBody(body);
+	}
+	bodies	= pool;
+	body	= pool ? pool->AddBody(transform) : -1;
+	if (pool) {
+		for (int c = RigidBodyPool::LinearVelocityX; c <= RigidBodyPool::InverseMass; ++c) {
+			pool->SetValue((RigidBodyPool::Component)c, body, localState[c]);
+		}
+	}
+}
 
+void PhysicsObject::SetBodyVector(RigidBodyPool::Component first, const Vector3& v) {
+	if (bodies) {
+		bodies->SetVector(first, body, v);
+		return;
+	}
+	localState[first]		= v.x;
+	localState[first + 1]	= v.y;
+	localState[first + 2]	= v.z;
+}
+
+void PhysicsObject::AddBodyVector(RigidBodyPool::Component first, const Vector3& v) {
+	if (bodies) {
+		bodies->AddVector(first, body, v);
+		return;
+	}
+	SetBodyVector(first, GetBodyVector(first) + v);
 }
 
 void PhysicsObject::ApplyAngularImpulse(const Vector3& force) {
-	angularVelocity += inverseInertiaTensor * force;
+	UpdateInertiaTensor();
+	AddBodyVector(RigidBodyPool::AngularVelocityX, inverseInertiaTensor * force);
+	Wake();
 }
 
 void PhysicsObject::ApplyLinearImpulse(const Vector3& force) {
-	linearVelocity += force * inverseMass;
+	AddBodyVector(RigidBodyPool::LinearVelocityX, force * GetInverseMass());
+	Wake();
 }
 
 void PhysicsObject::AddForce(const Vector3& addedForce) {
-	force += addedForce;
+	AddBodyVector(RigidBodyPool::ForceX, addedForce);
+	Wake();
 }
 
 void PhysicsObject::AddForceAtPosition(const Vector3& addedForce, const Vector3& position) {
 	Vector3 localPos = position - transform->GetPosition();
 
-	force  += addedForce;
-	torque += Vector3::Cross(localPos, addedForce);
+	AddBodyVector(RigidBodyPool::ForceX, addedForce);
+	AddBodyVector(RigidBodyPool::TorqueX, Vector3::Cross(localPos, addedForce));
+	Wake();
 }
 
 void PhysicsObject::AddTorque(const Vector3& addedTorque) {
-	torque += addedTorque;
+	AddBodyVector(RigidBodyPool::TorqueX, addedTorque);
+	Wake();
+}
+
+void PhysicsObject::Sleep() {
+	asleep = true;
+	SetBodyValue(RigidBodyPool::Active, 0.0f);
+	SetBodyVector(RigidBodyPool::LinearVelocityX, Vector3());
+	SetBodyVector(RigidBodyPool::AngularVelocityX, Vector3());
+}
+
+void PhysicsObject::SetBodyType(BodyType type) {
+	bodyType = type;
+	if (type != BodyType::Dynamic) {
+		SetInverseMass(0.0f);
+		SetBodyVector(RigidBodyPool::InverseInertiaX, Vector3());
+		inertiaDirty = true;
+	}
 }
 
 void PhysicsObject::ClearTorque() {
-	torque = Vector3();
+	SetBodyVector(RigidBodyPool::TorqueX, Vector3());
 }
 
 void PhysicsObject::ClearForces() {
-	force				= Vector3();
-	torque				= Vector3();
+	SetBodyVector(RigidBodyPool::ForceX, Vector3());
+	SetBodyVector(RigidBodyPool::TorqueX, Vector3());
+}
+
+/*
+Substeps don't line up with frames, so the renderer blends between the last
+two substeps to draw objects where they'd be at the time of the frame. They
+only turn a little in a substep, so a normalised lerp is as good as a slerp.
+Objects that haven't been stepped yet are just drawn where they are.
+*/
+Matrix4 PhysicsObject::GetInterpolatedMatrix(float alpha) const {
+	if (!bodies) {
+		return Matrix4::Translation(transform->GetPosition()) * Matrix4(transform->GetOrientation()) * Matrix4::Scale(transform->GetScale());
+	}
+	Vector3 position = Maths::Lerp(bodies->GetVector(RigidBodyPool::PreviousPositionX, body),
+		bodies->GetVector(RigidBodyPool::PositionX, body), alpha);
+
+	Quaternion orientation = Quaternion::Lerp(bodies->GetPreviousOrientation(body), bodies->GetOrientation(body), alpha);
+	orientation.Normalise();
+
+	return Matrix4::Translation(position) * Matrix4(orientation) * Matrix4::Scale(transform->GetScale());
 }
 
 void PhysicsObject::InitCubeInertia() {
@@ -56,30 +156,49 @@ void PhysicsObject::InitCubeInertia() {
 
 	Vector3 dimsSqr		= fullWidth * fullWidth;
 
+	float inverseMass	= GetInverseMass();
+
+	Vector3 inverseInertia;
 	inverseInertia.x = (12.0f * inverseMass) / (dimsSqr.y + dimsSqr.z);
 	inverseInertia.y = (12.0f * inverseMass) / (dimsSqr.x + dimsSqr.z);
 	inverseInertia.z = (12.0f * inverseMass) / (dimsSqr.x + dimsSqr.y);
+	SetBodyVector(RigidBodyPool::InverseInertiaX, inverseInertia);
+	inertiaDirty = true;
 }
 
 void PhysicsObject::InitSolidSphereInertia() {
 	float radius	= transform->GetScale().GetMaxElement();
-	float i			= 2.5f * inverseMass / (radius*radius); // ((2/5)*m*r^2
+	float i			= 2.5f * GetInverseMass() / (radius*radius); // ((2/5)*m*r^2
 
-	inverseInertia	= Vector3(i, i, i);
+	SetBodyVector(RigidBodyPool::InverseInertiaX, Vector3(i, i, i));
+	inertiaDirty = true;
 }
 
 void PhysicsObject::InitHollowSphereInertia() {
 	float radius	= transform->GetScale().GetMaxElement();
-	float i			= 1.5f * inverseMass / (radius * radius);
+	float i			= 1.5f * GetInverseMass() / (radius * radius);
 
-	inverseInertia = Vector3(i, i, i);
+	SetBodyVector(RigidBodyPool::InverseInertiaX, Vector3(i, i, i));
+	inertiaDirty = true;
 }
 
+/*
+Resting and sliding objects don't turn, and the solver asks for the tensor
+of every object it touches every substep, so it's only rebuilt if the
+orientation it was built for is out of date.
+*/
 void PhysicsObject::UpdateInertiaTensor() {
 	Quaternion q = transform->GetOrientation();
-	
+	if (!inertiaDirty && q == tensorOrientation) {
+		return;
+	}
+	tensorOrientation	= q;
+	inertiaDirty		= false;
+
 	Matrix3 invOrientation	= Matrix3(q.Conjugate());
 	Matrix3 orientation		= Matrix3(q);
 
+	Vector3 inverseInertia	= GetBodyVector(RigidBodyPool::InverseInertiaX);
+
 	inverseInertiaTensor = orientation * Matrix3::Scale(inverseInertia) *invOrientation;
 }
\ No newline at end of file
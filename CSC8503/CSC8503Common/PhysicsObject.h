@@ -1,6 +1,8 @@
 #pragma once
 #include "../../Common/Vector3.h"
 #include "../../Common/Matrix3.h"
+#include "../../Common/Matrix4.h"
+#include "RigidBodyPool.h"
 
 using namespace NCL::Maths;
 
@@ -10,33 +12,45 @@ namespace NCL {
 	namespace CSC8503 {
 		class Transform;
 
+		/*
+		Static bodies never move, and are kept apart from everything else in
+		the broadphase. Kinematic bodies are moved by the game, by setting their
+		velocity, and push dynamic bodies around without ever being pushed back.
+		Neither has any mass, or is affected by forces or gravity.
+		*/
+		enum class BodyType {
+			Static,
+			Kinematic,
+			Dynamic
+		};
+
 		class PhysicsObject	{
 		public:
 			PhysicsObject(Transform* parentTransform, const CollisionVolume* parentVolume);
 			~PhysicsObject();
 
 			Vector3 GetLinearVelocity() const {
-				return linearVelocity;
+				return GetBodyVector(RigidBodyPool::LinearVelocityX);
 			}
 
 			Vector3 GetAngularVelocity() const {
-				return angularVelocity;
+				return GetBodyVector(RigidBodyPool::AngularVelocityX);
 			}
 
 			Vector3 GetTorque() const {
-				return torque;
+				return GetBodyVector(RigidBodyPool::TorqueX);
 			}
 
 			Vector3 GetForce() const {
-				return force;
+				return GetBodyVector(RigidBodyPool::ForceX);
 			}
 
 			void SetInverseMass(float invMass) {
-				inverseMass = invMass;
+				SetBodyValue(RigidBodyPool::InverseMass, invMass);
 			}
 
 			float GetInverseMass() const {
-				return inverseMass;
+				return GetBodyValue(RigidBodyPool::InverseMass);
 			}
 
 			float GetElasticity() const {
@@ -67,41 +81,161 @@ namespace NCL {
 			void ClearForces();
 			void ClearTorque();
 
+			//Setting a velocity only wakes a sleeping object, it doesn't stop an awake one settling
 			void SetLinearVelocity(const Vector3& v) {
-				linearVelocity = v;
+				SetBodyVector(RigidBodyPool::LinearVelocityX, v);
+				if (asleep && v != Vector3()) {
+					Wake();
+				}
 			}
 
 			void SetAngularVelocity(const Vector3& v) {
-				angularVelocity = v;
+				SetBodyVector(RigidBodyPool::AngularVelocityX, v);
+				if (asleep && v != Vector3()) {
+					Wake();
+				}
+			}
+
+			//Sleeping objects aren't integrated or solved until something wakes them
+			bool IsAsleep() const {
+				return asleep;
+			}
+
+			void Wake() {
+				asleep		= false;
+				sleepTime	= 0.0f;
+				SetBodyValue(RigidBodyPool::Active, 1.0f);
+			}
+
+			void Sleep();
+
+			float GetSleepTime() const {
+				return sleepTime;
+			}
+
+			void SetSleepTime(float t) {
+				sleepTime = t;
+			}
+
+			//The model matrix alpha of the way from before the last substep to now
+			Matrix4 GetInterpolatedMatrix(float alpha) const;
+
+			/*
+			Continuous objects are given contacts with anything they could reach
+			within a substep, not just what they're already touching, so they
+			can't move so far in one substep that they pass through something.
+			*/
+			bool IsContinuous() const {
+				return continuous;
+			}
+
+			void SetContinuous(bool state) {
+				continuous = state;
+			}
+
+			BodyType GetBodyType() const {
+				return bodyType;
+			}
+
+			//Static and kinematic bodies lose their mass, so set the mass after making a body dynamic again
+			void SetBodyType(BodyType type);
+
+			//Sensors never touch anything, they only report what's overlapping them
+			bool IsSensor() const {
+				return sensor;
+			}
+
+			void SetSensor(bool state) {
+				sensor = state;
 			}
 
 			void InitCubeInertia();
 			void InitSolidSphereInertia();
 			void InitHollowSphereInertia();
 
+			//The world space tensor is only worked out when something asks for it to be,
+			//and only then if the object has turned, or been given a new inertia, since last time
 			void UpdateInertiaTensor();
 
 			Matrix3 GetInertiaTensor() const {
 				return inverseInertiaTensor;
 			}
 
+			/*
+			Until a PhysicsSystem first updates this object, its state is kept
+			in the object itself, and it has no handle. It's then moved into
+			that system's RigidBodyPool, or back out again if given nullptr.
+			*/
+			void SetBodyPool(RigidBodyPool* pool);
+
+			RigidBodyPool* GetBodyPool() const {
+				return bodies;
+			}
+
+			//Where this object's state is kept in its RigidBodyPool, -1 if it isn't in one
+			int GetBodyHandle() const {
+				return body;
+			}
+
+			//Where this object is in the ConstraintSolver's bodies, -1 if it isn't
+			int GetSolverIndex() const {
+				return solverIndex;
+			}
+
+			void SetSolverIndex(int index) {
+				solverIndex = index;
+			}
+
+			//Where this object was last put in the IslandBuilder's bodies
+			int GetIslandIndex() const {
+				return islandIndex;
+			}
+
+			void SetIslandIndex(int index) {
+				islandIndex = index;
+			}
+
 		protected:
+			float GetBodyValue(RigidBodyPool::Component c) const {
+				return bodies ? bodies->GetValue(c, body) : localState[c];
+			}
+
+			void SetBodyValue(RigidBodyPool::Component c, float value) {
+				if (bodies) {
+					bodies->SetValue(c, body, value);
+				}
+				else {
+					localState[c] = value;
+				}
+			}
+
+			Vector3 GetBodyVector(RigidBodyPool::Component first) const {
+				return bodies ? bodies->GetVector(first, body) : Vector3(localState[first], localState[first + 1], localState[first + 2]);
+			}
+
+			void SetBodyVector(RigidBodyPool::Component first, const Vector3& v);
+			void AddBodyVector(RigidBodyPool::Component first, const Vector3& v);
+
 			const CollisionVolume* volume;
 			Transform*		transform;
+			RigidBodyPool*	bodies;		//nullptr until a PhysicsSystem has updated this object
+			int				body;
+			float			localState[RigidBodyPool::ComponentCount];	//only used while bodies is nullptr
 
-			float inverseMass;
 			float elasticity;
 			float friction;
-
-			//linear stuff
-			Vector3 linearVelocity;
-			Vector3 force;
-			
-			//angular stuff
-			Vector3 angularVelocity;
-			Vector3 torque;
-			Vector3 inverseInertia;
-			Matrix3 inverseInertiaTensor;
+			int   solverIndex;
+			int   islandIndex;
+			bool  asleep;
+			bool  continuous;
+			bool  sensor;
+			BodyType bodyType;
+			float sleepTime; //how long the object has been moving slowly enough to sleep
+
+			//velocities, forces, mass and local inertia are all kept in the pool, or localState
+			Matrix3		inverseInertiaTensor;
+			Quaternion	tensorOrientation;	//the orientation the tensor was last built for
+			bool		inertiaDirty;
 		};
 	}
 }
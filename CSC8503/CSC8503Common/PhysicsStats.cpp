@@ -0,0 +1,85 @@
+#include "PhysicsStats.h"
+
+using namespace NCL;
+using namespace CSC8503;
+
+void PhysicsStepStats::WriteCSVHeader(std::ostream& out) {
+	out << "substep,broadphase_ms,narrowphase_ms,islands_ms,solve_ms,integrate_ms,constraints_ms,total_ms,"
+		<< "proxies,candidate_pairs,contacts,constraints,solver_rows,awake_bodies\n";
+}
+
+void PhysicsStepStats::WriteCSV(std::ostream& out) const {
+	out << substep << ',' << broadphaseMS << ',' << narrowphaseMS << ',' << islandsMS << ','
+		<< solveMS << ',' << integrateMS << ',' << constraintsMS << ',' << GetTotalMS() << ','
+		<< proxies << ',' << candidatePairs << ',' << contacts << ',' << constraintsSolved << ','
+		<< solverRows << ',' << awakeBodies << '\n';
+}
+
+PhysicsStatsHistory::PhysicsStatsHistory(int capacity) {
+	SetCapacity(capacity);
+}
+
+void PhysicsStatsHistory::Add(const PhysicsStepStats& stats) {
+	steps[next] = stats;
+	next = (next + 1) % GetCapacity();
+	count = count < GetCapacity() ? count + 1 : count;
+}
+
+void PhysicsStatsHistory::Clear() {
+	next	= 0;
+	count	= 0;
+}
+
+void PhysicsStatsHistory::SetCapacity(int capacity) {
+	steps.assign(capacity < 1 ? 1 : capacity, PhysicsStepStats());
+	Clear();
+}
+
+/*
+The counts are averaged too, rounded down, so a graph of them doesn't
+jump about as much as the counts of each individual substep would.
+*/
+PhysicsStepStats PhysicsStatsHistory::GetAverage(int averageCount) const {
+	PhysicsStepStats average;
+	averageCount = averageCount < count ? averageCount : count;
+	if (averageCount == 0) {
+		return average;
+	}
+	for (int i = count - averageCount; i < count; ++i) {
+		const PhysicsStepStats& s = Get(i);
+		average.broadphaseMS		+= s.broadphaseMS;
+		average.narrowphaseMS		+= s.narrowphaseMS;
+		average.islandsMS			+= s.islandsMS;
+		average.solveMS				+= s.solveMS;
+		average.integrateMS			+= s.integrateMS;
+		average.constraintsMS		+= s.constraintsMS;
+		average.proxies				+= s.proxies;
+		average.candidatePairs		+= s.candidatePairs;
+		average.contacts			+= s.contacts;
+		average.constraintsSolved	+= s.constraintsSolved;
+		average.solverRows			+= s.solverRows;
+		average.awakeBodies			+= s.awakeBodies;
+	}
+	float scale = 1.0f / averageCount;
+	average.substep				= GetLatest().substep;
+	average.broadphaseMS		*= scale;
+	average.narrowphaseMS		*= scale;
+	average.islandsMS			*= scale;
+	average.solveMS				*= scale;
+	average.integrateMS			*= scale;
+	average.constraintsMS		*= scale;
+	average.proxies				/= averageCount;
+	average.candidatePairs		/= averageCount;
+	average.contacts			/= averageCount;
+	average.constraintsSolved	/= averageCount;
+	average.solverRows			/= averageCount;
+	average.awakeBodies			/= averageCount;
+	return average;
+}
+
+void PhysicsStatsHistory::WriteCSV(std::ostream& out) const {
+	PhysicsStepStats::WriteCSVHeader(out);
+	for (int i = 0; i < count; ++i) {
+		Get(i).WriteCSV(out);
+	}
+}
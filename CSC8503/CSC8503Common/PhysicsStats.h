@@ -0,0 +1,80 @@
+#pragma once
+#include <vector>
+#include <ostream>
+
+namespace NCL {
+	namespace CSC8503 {
+		//What a single physics substep spent its time on, and how much it had to deal with
+		struct PhysicsStepStats {
+			int		substep				= 0;
+
+			float	broadphaseMS		= 0.0f;
+			float	narrowphaseMS		= 0.0f;
+			float	islandsMS			= 0.0f;	//building islands, and putting them to sleep
+			float	solveMS				= 0.0f;	//adding the contact rows, and solving everything
+			float	integrateMS			= 0.0f;
+			float	constraintsMS		= 0.0f;	//adding the constraint rows
+
+			int		proxies				= 0;
+			int		candidatePairs		= 0;	//pairs passed on by the broadphase
+			int		contacts			= 0;	//manifold points that are really touching, not speculative
+			int		constraintsSolved	= 0;
+			int		solverRows			= 0;
+			int		awakeBodies			= 0;
+
+			float GetTotalMS() const {
+				return broadphaseMS + narrowphaseMS + islandsMS + solveMS + integrateMS + constraintsMS;
+			}
+
+			static void WriteCSVHeader(std::ostream& out);
+			void WriteCSV(std::ostream& out) const;
+		};
+
+		/*
+		The stats of the last however many substeps, in a ring buffer, so the
+		newest overwrite the oldest once it's full, and keeping them never
+		allocates anything after the buffer is first made.
+		*/
+		class PhysicsStatsHistory	{
+		public:
+			PhysicsStatsHistory(int capacity = 600);
+			~PhysicsStatsHistory() {}
+
+			void Add(const PhysicsStepStats& stats);
+			void Clear();
+
+			//Throws away everything kept so far
+			void SetCapacity(int capacity);
+
+			int GetCapacity() const {
+				return (int)steps.size();
+			}
+
+			int GetCount() const {
+				return count;
+			}
+
+			//0 is the oldest substep kept
+			const PhysicsStepStats& Get(int index) const {
+				int oldest = (next - count + GetCapacity()) % GetCapacity();
+				return steps[(oldest + index) % GetCapacity()];
+			}
+
+			//Only valid if anything has been added
+			const PhysicsStepStats& GetLatest() const {
+				return Get(count - 1);
+			}
+
+			//The timings and counts averaged over the last count substeps
+			PhysicsStepStats GetAverage(int count) const;
+
+			//A header line, then every substep kept, oldest first
+			void WriteCSV(std::ostream& out) const;
+
+		protected:
+			std::vector<PhysicsStepStats> steps;
+			int next;	//where the next substep goes
+			int count;
+		};
+	}
+}
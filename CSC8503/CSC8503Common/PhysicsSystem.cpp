@@ -5,7 +5,13 @@
 #include "../../Common/Quaternion.h"
 #include "Constraint.h"
 #include "Debug.h"
+#include "QuadTreeBroadPhase.h"
+#include "AABBTreeBroadPhase.h"
+#include "SweepAndPruneBroadPhase.h"
+#include "HashGridBroadPhase.h"
 #include <functional>
+#include <cfloat>
+#include <cmath>
 using namespace NCL;
 using namespace CSC8503;
 
@@ -20,17 +26,65 @@ PhysicsSystem::PhysicsSystem(GameWorld& g) : gameWorld(g)	{
 	applyGravity	= true;
 	useBroadPhase	= true;	
 	dTOffset		= 0.0f;
+	maxSubsteps		= 8;
 	globalDamping	= 0.995f;
+	broadPhase		= nullptr;
+	workers			= nullptr;
+	substepCount	= 0;
+	velocityIterations	= 10;
+	positionIterations	= 3;
+	allowSleeping		= true;
+	SetSleepThresholds(0.05f, 0.05f, 0.5f);
+	SetThreadCount(1);
 	SetGravity(Vector3(0.0f, -9.8f, 0.0f));
+	SetFixedRate(120);
+	SetBroadPhase(BroadPhaseType::AABBTree);
 }
 
+/*
+Anything still in the world keeps its state, in case it's stepped by
+another system later, and so it doesn't try to leave the pool once the
+pool is gone.
+*/
 PhysicsSystem::~PhysicsSystem()	{
+	gameWorld.OperateOnContents([&](GameObject* o) {
+		PhysicsObject* object = o->GetPhysicsObject();
+		if (object && object->GetBodyPool() == &bodyPool) {
+			object->SetBodyPool(nullptr);
+		}
+	});
+	delete broadPhase;
+	delete workers;
+}
+
+void PhysicsSystem::SetThreadCount(int count) {
+	delete workers;
+	workers = new WorkerPool(count < 1 ? 1 : count);
+}
+
+void PhysicsSystem::SetBroadPhase(BroadPhaseType type) {
+	delete broadPhase;
+	broadPhaseType = type;
+	broadphaseCollisions.Clear();
+	staticCollisions.Clear();
+
+	switch (type) {
+		case BroadPhaseType::QuadTree:	broadPhase = new QuadTreeBroadPhase(Vector2(1024, 1024), 7, 6); break;
+		case BroadPhaseType::AABBTree:	broadPhase = new AABBTreeBroadPhase(0.5f); break;
+		case BroadPhaseType::SweepAndPrune: broadPhase = new SweepAndPruneBroadPhase(); break;
+		case BroadPhaseType::HashGrid:	broadPhase = new HashGridBroadPhase({ 4.0f, 16.0f, 64.0f }, 4096); break;
+	}
 }
 
 void PhysicsSystem::SetGravity(const Vector3& g) {
 	gravity = g;
 }
 
+void PhysicsSystem::SetFixedRate(int hz) {
+	fixedHZ = hz < 1 ? 1 : hz;
+	fixedDT = 1.0f / fixedHZ;
+}
+
 /*
 
 If the 'game' is ever reset, the PhysicsSystem must be
@@ -42,123 +96,180 @@ any collisions they are in.
 
 */
 void PhysicsSystem::Clear() {
-	allCollisions.clear();
+	allCollisions.Clear();
+	manifolds.Clear();
+	pairCaches.Clear();
+	sensorOverlaps.Clear();
+	sensorListeners.clear();
+	collisionEvents.Clear();
+	islands.Clear();
+	broadphaseCollisions.Clear();
+	staticCollisions.Clear();
+	broadPhase->Clear();
+	stats.Clear();
 }
 
 /*
 
 This is the core of the physics engine update
 
-*/
-int constraintIterationCount = 10;
-
-//This is the fixed timestep we'd LIKE to have
-const int   idealHZ = 120;
-const float idealDT = 1.0f / idealHZ;
+The world is always stepped at the same fixed rate, however long the frames
+are, so the simulation comes out the same whatever the framerate. Time is
+built up until there's enough for a whole substep, and whatever is left over
+is used to blend the rendered objects between the last two substeps.
 
-/*
-This is the fixed update we actually have...
-If physics takes too long it starts to kill the framerate, it'll drop the 
-iteration count down until the FPS stabilises, even if that ends up
-being at a low rate. 
+No more than maxSubsteps are run in a single update. If physics can't keep
+up, running more substeps to catch up would only make the next frame longer
+still, so the time that couldn't be simulated is thrown away, and the game
+just runs a little slower for a while.
 */
-int realHZ		= idealHZ;
-float realDT	= idealDT;
-
 void PhysicsSystem::Update(float dt) {	
-	if (Window::GetKeyboard()->KeyPressed(KeyboardKeys::B)) {
-		useBroadPhase = !useBroadPhase;
-		std::cout << "Setting broadphase to " << useBroadPhase << std::endl;
-	}
-	if (Window::GetKeyboard()->KeyPressed(KeyboardKeys::I)) {
-		constraintIterationCount--;
-		std::cout << "Setting constraint iterations to " << constraintIterationCount << std::endl;
-	}
-	if (Window::GetKeyboard()->KeyPressed(KeyboardKeys::O)) {
-		constraintIterationCount++;
-		std::cout << "Setting constraint iterations to " << constraintIterationCount << std::endl;
+	//There's no keyboard when running headless, like in the benchmarks
+	if (Window::GetKeyboard()) {
+		UpdateDebugKeys();
 	}
 
 	dTOffset += dt; //We accumulate time delta here - there might be remainders from previous frame!
 
-	GameTimer t;
-	t.GetTimeDeltaSeconds();
+	GatherBodies();
 
 	if (useBroadPhase) {
 		UpdateObjectAABBs();
 	}
 
-	while(dTOffset >= realDT) {
-		IntegrateAccel(realDT); //Update accelerations from external forces
+	int substeps = 0;
+	while(dTOffset >= fixedDT && substeps < maxSubsteps) {
+		PhysicsStepStats step;
+		step.substep = substepCount;
+		stepTimer.Tick();
+
+		bodyPool.StorePreviousTransforms();
+
+		IntegrateAccel(fixedDT); //Update accelerations from external forces
+		stepTimer.Tick();
+		step.integrateMS = stepTimer.GetTimeDeltaMSec();
+
 		if (useBroadPhase) {
 			BroadPhase();
+			stepTimer.Tick();
+			step.broadphaseMS	= stepTimer.GetTimeDeltaMSec();
+			step.proxies		= broadPhase->GetProxyCount();
+			step.candidatePairs = broadphaseCollisions.GetCount() + staticCollisions.GetCount();
 			NarrowPhase();
 		}
 		else {
 			BasicCollisionDetection();
 		}
+		RemoveStaleManifolds();
+		RemoveStaleSensorOverlaps();
+		stepTimer.Tick();
+		step.narrowphaseMS	= stepTimer.GetTimeDeltaMSec();
+		step.contacts		= CountTouchingPoints();
+
+		UpdateIslands();
+		stepTimer.Tick();
+		step.islandsMS = stepTimer.GetTimeDeltaMSec();
+
+		//Contacts and constraints are all gathered up into the solver, and
+		//solved together, rather than one after the other
+		solver.Clear();
+		AddContactRows(fixedDT);
+		stepTimer.Tick();
+		step.solveMS = stepTimer.GetTimeDeltaMSec();
+
+		step.constraintsSolved = AddConstraintRows(fixedDT);
+		stepTimer.Tick();
+		step.constraintsMS = stepTimer.GetTimeDeltaMSec();
+
+		step.solverRows = solver.GetRowCount();
+		solver.Solve(velocityIterations, positionIterations, workers);
+		stepTimer.Tick();
+		step.solveMS += stepTimer.GetTimeDeltaMSec();
+
+		UpdateSleeping(fixedDT);
+		stepTimer.Tick();
+		step.islandsMS		+= stepTimer.GetTimeDeltaMSec();
+		step.awakeBodies	= CountAwakeBodies();
+
+		IntegrateVelocity(fixedDT); //update positions from new velocity changes
+		stepTimer.Tick();
+		step.integrateMS += stepTimer.GetTimeDeltaMSec();
+
+		stats.Add(step);
+
+		dTOffset -= fixedDT;
+		substepCount++;
+		substeps++;
+	}
 
-		//This is our simple iterative solver - 
-		//we just run things multiple times, slowly moving things forward
-		//and then rechecking that the constraints have been met		
-		float constraintDt = realDT /  (float)constraintIterationCount;
-		for (int i = 0; i < constraintIterationCount; ++i) {
-			UpdateConstraints(constraintDt);	
-		}
-		IntegrateVelocity(realDT); //update positions from new velocity changes
-
-		dTOffset -= realDT;
+	//Uh oh, physics is taking too long... keep only the part of a substep that's left over
+	if (dTOffset >= fixedDT) {
+		dTOffset = fmod(dTOffset, fixedDT);
 	}
 
 	ClearForces();	//Once we've finished with the forces, reset them to zero
 	UpdateCollisionList(); //Remove any old collisions
+	collisionEvents.Publish();
+}
 
-	t.Tick();
-	float updateTime = t.GetTimeDeltaSeconds();
-
-	//Uh oh, physics is taking too long...
-	if (updateTime > realDT) {
-		realHZ /= 2;
-		realDT *= 2;
-		std::cout << "Dropping iteration count due to long physics time...(now " << realHZ << ")\n";
+void PhysicsSystem::UpdateDebugKeys() {
+	if (Window::GetKeyboard()->KeyPressed(KeyboardKeys::B)) {
+		useBroadPhase = !useBroadPhase;
+		std::cout << "Setting broadphase to " << useBroadPhase << std::endl;
 	}
-	else if(dt*2 < realDT) { //we have plenty of room to increase iteration count!
-		int temp = realHZ;
-		realHZ *= 2;
-		realDT /= 2;
-
-		if (realHZ > idealHZ) {
-			realHZ = idealHZ;
-			realDT = idealDT;
-		}
-		if (temp != realHZ) {
-			std::cout << "Raising iteration count due to short physics time...(now " << realHZ << ")\n";
-		}
+	if (Window::GetKeyboard()->KeyPressed(KeyboardKeys::N)) {
+		static const char* names[] = { "QuadTree", "AABB tree", "sweep and prune", "hash grid" };
+		int next = ((int)broadPhaseType + 1) % (int)BroadPhaseType::MAX_BROADPHASE_TYPE;
+		SetBroadPhase((BroadPhaseType)next);
+		std::cout << "Setting broadphase structure to " << names[next] << std::endl;
+	}
+	if (Window::GetKeyboard()->KeyPressed(KeyboardKeys::M)) {
+		int hardwareThreads = (int)std::thread::hardware_concurrency();
+		SetThreadCount(GetThreadCount() == 1 ? hardwareThreads : 1);
+		std::cout << "Setting physics threads to " << GetThreadCount() << std::endl;
+	}
+	if (Window::GetKeyboard()->KeyPressed(KeyboardKeys::I)) {
+		velocityIterations = velocityIterations > 1 ? velocityIterations - 1 : 1;
+		std::cout << "Setting velocity iterations to " << velocityIterations << std::endl;
+	}
+	if (Window::GetKeyboard()->KeyPressed(KeyboardKeys::O)) {
+		velocityIterations++;
+		std::cout << "Setting velocity iterations to " << velocityIterations << std::endl;
 	}
 }
 
 /*
 Later on we're going to need to keep track of collisions
-across multiple frames, so we store them in a set.
+across multiple frames, so we store them in a PairMap, keyed
+by the world IDs of the two objects.
 
-The first time they are added, we tell the objects they are colliding.
-The frame they are to be removed, we tell them they're no longer colliding.
+The first time they are added, an event is queued to say they've begun
+colliding. Every time they're found colliding again, they're given another
+few frames, and once they've gone that long without touching, they're
+removed, and an event is queued to say they've stopped.
 
 From this simple mechanism, we we build up gameplay interactions inside the
 OnCollisionBegin / OnCollisionEnd functions (removing health when hit by a 
 rocket launcher, gaining a point when the player hits the gold coin, and so on).
 */
+void PhysicsSystem::AddCollision(PairKey key, const CollisionDetection::CollisionInfo& info) {
+	std::pair<CollisionDetection::CollisionInfo*, bool> inserted = allCollisions.Insert(key, info);
+	inserted.first->framesLeft = numCollisionFrames;
+	if (inserted.second) {
+		collisionEvents.Push(CollisionEventType::Begin, info.a, info.b);
+	}
+}
+
 void PhysicsSystem::UpdateCollisionList() {
-	for (std::set<CollisionDetection::CollisionInfo>::iterator i = allCollisions.begin(); i != allCollisions.end(); ) {
-		if ((*i).framesLeft == numCollisionFrames) {
-			i->a->OnCollisionBegin(i->b);
-			i->b->OnCollisionBegin(i->a);
+	for (int i = 0; i < allCollisions.GetCount(); ) {
+		CollisionDetection::CollisionInfo& info = allCollisions[i];
+		if (info.framesLeft == numCollisionFrames) {
+			collisionEvents.Push(CollisionEventType::Stay, info.a, info.b);
 		}
-		(*i).framesLeft = (*i).framesLeft - 1;
-		if ((*i).framesLeft < 0) {
-			i->a->OnCollisionEnd(i->b);
-			i->b->OnCollisionEnd(i->a);
-			i = allCollisions.erase(i);
+		info.framesLeft = info.framesLeft - 1;
+		if (info.framesLeft < 0) {
+			collisionEvents.Push(CollisionEventType::End, info.a, info.b);
+			allCollisions.RemoveAt(i); //the last collision is moved into slot i
 		}
 		else {
 			++i;
@@ -166,13 +277,60 @@ void PhysicsSystem::UpdateCollisionList() {
 	}
 }
 
+/*
+Events are only handed out here, after the world has finished stepping, so
+anything done in response, like moving or hiding an object, can't upset
+the substep that found them.
+*/
+void PhysicsSystem::DispatchCollisionEvents() {
+	collisionEvents.Drain(dispatchedEvents);
+
+	for (const CollisionEvent& e : dispatchedEvents) {
+		switch (e.type) {
+			case CollisionEventType::Begin:
+				e.a->OnCollisionBegin(e.b);
+				e.b->OnCollisionBegin(e.a);
+				break;
+			case CollisionEventType::End:
+				e.a->OnCollisionEnd(e.b);
+				e.b->OnCollisionEnd(e.a);
+				break;
+			case CollisionEventType::TriggerEnter:
+			case CollisionEventType::TriggerLeave: {
+				auto found = sensorListeners.find(e.a->GetWorldID());
+				if (found == sensorListeners.end()) {
+					break;
+				}
+				for (const SensorCallback& callback : found->second) {
+					callback(e.a, e.b, e.type == CollisionEventType::TriggerEnter);
+				}
+			} break;
+			default:
+				break;
+		}
+	}
+}
+
 void PhysicsSystem::UpdateObjectAABBs() {
 	std::vector<GameObject*>::const_iterator first;
 	std::vector<GameObject*>::const_iterator last;
 	gameWorld.GetObjectIterators(first, last);
 
 	for (auto i = first; i != last; ++i) {
+		PhysicsObject* object = (*i)->GetPhysicsObject();
+		if (object && object->IsAsleep()) {
+			continue; // it can't have moved or rotated
+		}
+		if (object && object->GetBodyType() == BodyType::Static) {
+			continue; // the broadphase works it out once, when it first sees the object
+		}
 		(*i)->UpdateBroadphaseAABB();
+
+		//Continuous objects need pairs with anything they could reach this substep
+		if (object && object->IsContinuous()) {
+			Vector3 v = object->GetLinearVelocity();
+			(*i)->ExpandBroadphaseAABB(Vector3(abs(v.x), abs(v.y), abs(v.z)) * fixedDT);
+		}
 	}
 }
 
@@ -181,9 +339,9 @@ void PhysicsSystem::UpdateObjectAABBs() {
 This is how we'll be doing collision detection in tutorial 4.
 We step thorugh every pair of objects once (the inner for loop offset 
 ensures this), and determine whether they collide, and if so, add them
-to the collision set for later processing. The set will guarantee that
+to the collision map for later processing. The map will guarantee that
 a particular pair will only be added once, so objects colliding for
-multiple frames won't flood the set with duplicates.
+multiple frames won't flood the map with duplicates.
 */
 void PhysicsSystem::BasicCollisionDetection() {
 	std::vector<GameObject*>::const_iterator first;
@@ -198,31 +356,85 @@ void PhysicsSystem::BasicCollisionDetection() {
 			if ((*j)->GetPhysicsObject() == nullptr)
 				continue;
 
+			if (!CanCollide(*i, *j)) {
+				continue;
+			}
+
+			if (IsPairAsleep(*i, *j)) {
+				KeepPairAsleep(MakePairKey(*i, *j));
+				continue;
+			}
+
+			if (IsSensorPair(*i, *j)) {
+				if (CollisionDetection::OverlapTest(*i, *j)) {
+					UpdateSensorOverlap(MakePairKey(*i, *j), *i, *j);
+				}
+				continue;
+			}
+
 			CollisionDetection::CollisionInfo info;
 
 			if (CollisionDetection::ObjectIntersection(*i, *j, info)) {
-				if (info.b->GetName() == "bonus") {
-					CollectBonus(*info.a, *info.b);
-					continue;
+				UpdateManifold(info);
+				AddCollision(MakePairKey(info.a, info.b), info);
+			}
+			else if (float margin = SpeculativeMargin(*i, *j)) {
+				if (CollisionDetection::SpeculativeIntersection(*i, *j, margin, info)) {
+					UpdateManifold(info);
 				}
-				ImpulseResolveCollision(*info.a, *info.b, info.point);
-				info.framesLeft = numCollisionFrames;
-				allCollisions.insert(info);
 			}
 		}
 	}
 }
 
-void PhysicsSystem::CollectBonus(GameObject& a, GameObject& b) const {
-	Transform& transformB = b.GetTransform();
-	RenderObject* rendB = b.GetRenderObject();
+/*
+Sensors don't go through the narrowphase properly, they're only checked
+for whether they overlap anything, and that's then turned into enter and
+leave events for whoever is listening to them. They never get any contact
+points, so nothing is ever pushed out of them.
+*/
+bool PhysicsSystem::IsSensorPair(GameObject* a, GameObject* b) const {
+	PhysicsObject* physA = a->GetPhysicsObject();
+	PhysicsObject* physB = b->GetPhysicsObject();
+	return (physA && physA->IsSensor()) || (physB && physB->IsSensor());
+}
+
+void PhysicsSystem::AddSensorListener(int sensorID, const SensorCallback& callback) {
+	sensorListeners[sensorID].emplace_back(callback);
+}
+
+void PhysicsSystem::UpdateSensorOverlap(PairKey key, GameObject* a, GameObject* b) {
+	std::pair<SensorOverlap*, bool> inserted = sensorOverlaps.Insert(key, { a, b, substepCount });
+	inserted.first->lastUpdate = substepCount;
+	if (inserted.second) {
+		QueueSensorEvents(a, b, true);
+	}
+}
 
-	transformB.SetPosition(Vector3(0, 200, 0));
-	rendB->SetColour(Vector4(0, 0, 0, 0));
-	
-	// got this little trick from stack overflow https://stackoverflow.com/a/5030086
-	unsigned int playerIndex = a.GetName()[6] - '0';
-	gameWorld.playerScores[(char)playerIndex - 1] += 30;
+//Anything that wasn't found overlapping its sensor this substep has left it
+void PhysicsSystem::RemoveStaleSensorOverlaps() {
+	for (int i = 0; i < sensorOverlaps.GetCount(); ) {
+		if (sensorOverlaps[i].lastUpdate != substepCount) {
+			SensorOverlap overlap = sensorOverlaps[i];
+			sensorOverlaps.RemoveAt(i);
+			QueueSensorEvents(overlap.a, overlap.b, false);
+		}
+		else {
+			++i;
+		}
+	}
+}
+
+//If both objects are sensors, they each get an event about the other
+void PhysicsSystem::QueueSensorEvents(GameObject* a, GameObject* b, bool entered) {
+	CollisionEventType type = entered ? CollisionEventType::TriggerEnter : CollisionEventType::TriggerLeave;
+	GameObject* objects[2] = { a, b };
+	for (int i = 0; i < 2; ++i) {
+		PhysicsObject* physics = objects[i]->GetPhysicsObject();
+		if (physics && physics->IsSensor()) {
+			collisionEvents.Push(type, objects[i], objects[1 - i]);
+		}
+	}
 }
 
 /*
@@ -230,57 +442,262 @@ void PhysicsSystem::CollectBonus(GameObject& a, GameObject& b) const {
 In tutorial 5, we start determining the correct response to a collision,
 so that objects separate back out. 
 
+Rather than resolving each collision as soon as it is found, every pair of
+colliding objects keeps a ContactManifold, holding up to 4 contact points.
+These are all solved together once the narrowphase has finished.
+
 */
-void PhysicsSystem::ImpulseResolveCollision(GameObject& a, GameObject& b, CollisionDetection::ContactPoint& p) const {
-	PhysicsObject* physA = a.GetPhysicsObject();
-	PhysicsObject* physB = b.GetPhysicsObject();
+void PhysicsSystem::UpdateManifold(const CollisionDetection::CollisionInfo& info) {
+	if (!info.a->GetPhysicsObject() || !info.b->GetPhysicsObject()) {
+		return;
+	}
+	ContactManifold* m = manifolds.Insert(MakePairKey(info.a, info.b), ContactManifold()).first;
+	m->Update(info, substepCount);
+}
 
-	Transform& transformA = a.GetTransform();
-	Transform& transformB = b.GetTransform();
+//Any pair that wasn't found colliding this substep has separated
+void PhysicsSystem::RemoveStaleManifolds() {
+	for (int i = 0; i < manifolds.GetCount(); ) {
+		if (manifolds[i].lastUpdate != substepCount) {
+			manifolds.RemoveAt(i);
+		}
+		else {
+			++i;
+		}
+	}
+}
+
+namespace {
+	//Massless objects can still be moved by the game, by giving them a velocity
+	bool IsHeldStill(const PhysicsObject* object) {
+		return object->GetInverseMass() == 0 && object->GetLinearVelocity() == Vector3() && object->GetAngularVelocity() == Vector3();
+	}
+}
 
-	float totalMass = physA->GetInverseMass() + physB->GetInverseMass();
+/*
+Static objects never sleep, but they can't wake anything up either. A pair
+is left alone if neither object can move, and at least one is asleep.
+*/
+bool PhysicsSystem::IsPairAsleep(GameObject* a, GameObject* b) const {
+	PhysicsObject* physA = a->GetPhysicsObject();
+	PhysicsObject* physB = b->GetPhysicsObject();
+	if (!physA || !physB) {
+		return false;
+	}
+	bool restingA = physA->IsAsleep() || IsHeldStill(physA);
+	bool restingB = physB->IsAsleep() || IsHeldStill(physB);
+	return restingA && restingB && (physA->IsAsleep() || physB->IsAsleep());
+}
+
+/*
+Sleeping pairs skip the narrowphase, but they're still touching, so their
+manifold is kept for when they wake up, and the collision list still gets
+them, as if they'd been found colliding again. Anything sleeping in a
+sensor is still in it.
+*/
+void PhysicsSystem::KeepPairAsleep(PairKey key) {
+	if (SensorOverlap* overlap = sensorOverlaps.Find(key)) {
+		overlap->lastUpdate = substepCount;
+	}
 
-	// two static objects that shouldn't move?
-	if (totalMass == 0)
+	ContactManifold* m = manifolds.Find(key);
+	if (!m) {
 		return;
+	}
+	m->lastUpdate = substepCount;
+
+	CollisionDetection::CollisionInfo info;
+	info.a			= m->a;
+	info.b			= m->b;
+	AddCollision(key, info);
+}
+
+/*
+Every moving object is put into an island with everything it's touching or
+constrained to. If anything in an island is awake, the whole island is
+woken up, so an object hitting a sleeping pile wakes the entire pile.
+*/
+void PhysicsSystem::UpdateIslands() {
+	islands.Clear();
+
+	std::vector<GameObject*>::const_iterator first;
+	std::vector<GameObject*>::const_iterator last;
+	gameWorld.GetObjectIterators(first, last);
 
-	if (b.GetName() == "slippery") {
-		physB->SetElasticity(35.0f);
+	for (auto i = first; i != last; ++i) {
+		PhysicsObject* object = (*i)->GetPhysicsObject();
+		if (object && object->GetInverseMass() > 0) {
+			islands.AddBody(*i);
+		}
+	}
+	for (const ContactManifold& m : manifolds) {
+		islands.Connect(m.a, m.b);
 	}
 
-	// separate them out using projection (position)
-	transformA.SetPosition(transformA.GetPosition() - (p.normal * p.penetration * (physA->GetInverseMass() / totalMass)));
-	transformB.SetPosition(transformB.GetPosition() + (p.normal * p.penetration * (physB->GetInverseMass() / totalMass)));
+	std::vector<Constraint*>::const_iterator firstConstraint;
+	std::vector<Constraint*>::const_iterator lastConstraint;
+	gameWorld.GetConstraintIterators(firstConstraint, lastConstraint);
 
-	Vector3 relativeA = p.localA;
-	Vector3 relativeB = p.localB;
+	for (auto i = firstConstraint; i != lastConstraint; ++i) {
+		islands.Connect((*i)->GetObjectA(), (*i)->GetObjectB());
+	}
+	islands.Build();
+
+	//Kinematic objects aren't in any island, but anything they push into has to move out of their way
+	for (const ContactManifold& m : manifolds) {
+		PhysicsObject* physA = m.a->GetPhysicsObject();
+		PhysicsObject* physB = m.b->GetPhysicsObject();
+		if (physA->IsAsleep() && physB->GetBodyType() == BodyType::Kinematic && !IsHeldStill(physB)) {
+			physA->Wake();
+		}
+		if (physB->IsAsleep() && physA->GetBodyType() == BodyType::Kinematic && !IsHeldStill(physA)) {
+			physB->Wake();
+		}
+	}
 
-	Vector3 angVelocityA = Vector3::Cross(physA->GetAngularVelocity(), relativeA);
-	Vector3 angVelocityB = Vector3::Cross(physB->GetAngularVelocity(), relativeB);
+	for (int i = 0; i < islands.GetIslandCount(); ++i) {
+		const Island& island = islands.GetIsland(i);
 
-	Vector3 fullVelocityA = physA->GetLinearVelocity() + angVelocityA;
-	Vector3 fullVelocityB = physB->GetLinearVelocity() + angVelocityB;
+		bool awake = false;
+		for (int j = 0; j < island.bodyCount && !awake; ++j) {
+			awake = !islands.GetIslandBody(island.firstBody + j)->GetPhysicsObject()->IsAsleep();
+		}
+		if (!awake) {
+			continue;
+		}
+		for (int j = 0; j < island.bodyCount; ++j) {
+			PhysicsObject* object = islands.GetIslandBody(island.firstBody + j)->GetPhysicsObject();
+			if (object->IsAsleep()) {
+				object->Wake();
+			}
+		}
+	}
+}
+
+/*
+Islands always go to sleep as a whole, so an island is awake if its first
+body is.
+*/
+int PhysicsSystem::CountAwakeBodies() const {
+	int awake = 0;
+	for (int i = 0; i < islands.GetIslandCount(); ++i) {
+		const Island& island = islands.GetIsland(i);
+		if (!islands.GetIslandBody(island.firstBody)->GetPhysicsObject()->IsAsleep()) {
+			awake += island.bodyCount;
+		}
+	}
+	return awake;
+}
+
+/*
+Each object keeps track of how long it has been moving slowly, and once the
+slowest to settle in an island has been still for long enough, the whole
+island goes to sleep together. Putting objects to sleep one at a time would
+leave the rest of a pile pushing against something that no longer moves.
+*/
+void PhysicsSystem::UpdateSleeping(float dt) {
+	if (!allowSleeping) {
+		return;
+	}
+	float linearTolerance	= linearSleepTolerance * linearSleepTolerance;
+	float angularTolerance	= angularSleepTolerance * angularSleepTolerance;
+
+	for (int i = 0; i < islands.GetIslandCount(); ++i) {
+		const Island& island = islands.GetIsland(i);
+
+		float minSleepTime = FLT_MAX;
+		for (int j = 0; j < island.bodyCount; ++j) {
+			PhysicsObject* object = islands.GetIslandBody(island.firstBody + j)->GetPhysicsObject();
+			if (object->IsAsleep()) {
+				minSleepTime = 0.0f; // the whole island is already asleep
+				break;
+			}
+			if (object->GetLinearVelocity().LengthSquared() > linearTolerance ||
+				object->GetAngularVelocity().LengthSquared() > angularTolerance) {
+				object->SetSleepTime(0.0f);
+			}
+			else {
+				object->SetSleepTime(object->GetSleepTime() + dt);
+			}
+			minSleepTime = object->GetSleepTime() < minSleepTime ? object->GetSleepTime() : minSleepTime;
+		}
+
+		if (minSleepTime < timeToSleep) {
+			continue;
+		}
+		for (int j = 0; j < island.bodyCount; ++j) {
+			islands.GetIslandBody(island.firstBody + j)->GetPhysicsObject()->Sleep();
+		}
+	}
+}
+
+//Speculative points, which are still a little way apart, aren't counted
+int PhysicsSystem::CountTouchingPoints() const {
+	int touching = 0;
+	for (const ContactManifold& m : manifolds) {
+		for (int i = 0; i < m.pointCount; ++i) {
+			touching += m.points[i].penetration >= 0.0f ? 1 : 0;
+		}
+	}
+	return touching;
+}
+
+/*
+Every contact point becomes a velocity row, which can only push the objects
+apart, and a position row, which replaces the projection we used to do as
+soon as a collision was found. Each velocity row starts from the impulse its
+point ended up with last substep (warm starting).
+
+The restitution of a contact is only used if the objects hit each other
+hard enough, otherwise resting objects would keep bouncing on each other.
+Objects are also left overlapping very slightly, so that resting contacts
+are still found by the narrowphase next substep.
+
+Speculative points, between a continuous object and something it hasn't
+reached yet, have a negative penetration - the gap between them. Their
+velocity row only lets the objects close that gap this substep, so they
+meet instead of passing through each other, and their position row never
+has anything to push apart.
+*/
+void PhysicsSystem::AddContactRows(float dt) {
+	const float restitutionThreshold	= 1.0f;
+	const float contactSlop				= 0.005f;
+
+	for (ContactManifold& m : manifolds) {
+		PhysicsObject* physA = m.a->GetPhysicsObject();
+		PhysicsObject* physB = m.b->GetPhysicsObject();
+
+		// two static objects that shouldn't move?
+		if (physA->GetInverseMass() + physB->GetInverseMass() == 0 || IsPairAsleep(m.a, m.b)) {
+			continue;
+		}
 
-	Vector3 contactVelocity = fullVelocityB - fullVelocityA;
+		float cRestitution = 0.66f * physA->GetElasticity() * physB->GetElasticity(); // disperse some kinetic energy
 
-	float impulseForce = Vector3::Dot(contactVelocity, p.normal);
+		int island = islands.GetIslandOf(m.a);
+		solver.SetIsland(island != -1 ? island : islands.GetIslandOf(m.b));
 
-	// now to work out the effect of inertia...
-	Vector3 inertiaA = Vector3::Cross(physA->GetInertiaTensor() * Vector3::Cross(relativeA, p.normal), relativeA);
-	Vector3 inertiaB = Vector3::Cross(physB->GetInertiaTensor() * Vector3::Cross(relativeB, p.normal), relativeB);
-	float angularEffect = Vector3::Dot(inertiaA + inertiaB, p.normal);
+		int a = solver.AddBody(m.a);
+		int b = solver.AddBody(m.b);
 
-	float cRestitution = 0.66f * physA->GetElasticity() * physB->GetElasticity(); // disperse some kinetic energy
+		for (int i = 0; i < m.pointCount; ++i) {
+			ManifoldPoint& p = m.points[i];
 
-	float j = (-(1.0f + cRestitution) * impulseForce) / (totalMass + angularEffect);
+			Vector3 fullVelocityA = physA->GetLinearVelocity() + Vector3::Cross(physA->GetAngularVelocity(), p.localA);
+			Vector3 fullVelocityB = physB->GetLinearVelocity() + Vector3::Cross(physB->GetAngularVelocity(), p.localB);
+			float approachSpeed = Vector3::Dot(fullVelocityB - fullVelocityA, p.normal);
 
-	Vector3 fullImpulse = p.normal * j;
+			float bias = approachSpeed < -restitutionThreshold ? -cRestitution * approachSpeed : 0.0f;
 
-	physA->ApplyLinearImpulse(-fullImpulse);
-	physB->ApplyLinearImpulse(fullImpulse);
+			//A speculative point lets the objects close the gap this substep, but no more
+			if (p.penetration < 0.0f) {
+				bias = p.penetration / dt;
+			}
 
-	physA->ApplyAngularImpulse(Vector3::Cross(relativeA, -fullImpulse));
-	physB->ApplyAngularImpulse(Vector3::Cross(relativeB, fullImpulse));
+			solver.AddVelocityRow(a, b, p.normal, p.localA, p.localB, bias, 0.0f, FLT_MAX, &p.normalImpulse);
+			solver.AddPositionRow(a, b, p.normal, contactSlop - p.penetration, true);
+		}
+	}
 }
 
 void PhysicsSystem::ResolveSpringCollision(GameObject& a, GameObject& b, CollisionDetection::ContactPoint& p) const
@@ -308,36 +725,42 @@ and a narrowphase collision detection method. In the broad phase, we
 split the world up using an acceleration structure, so that we can only
 compare the collisions that we absolutely need to. 
 
+The structure persists between substeps, and only updates the objects
+that have actually moved since it was last used. Pairs are written into a
+flat buffer, which is then sorted to remove any duplicates - a QuadTree
+finds a pair once for every leaf both objects are in. Incremental
+structures like sweep and prune keep the buffer itself up to date instead.
+
+Pairs with static bodies come from a separate buffer, rebuilt every time
+from what each proxy remembers overlapping, and are tested after the rest.
+
 */
 
 void PhysicsSystem::BroadPhase() {
-	broadphaseCollisions.clear();
-	QuadTree<GameObject*> tree(Vector2(1024, 1024), 7, 6);
+	bool incremental = broadPhase->IsIncremental();
+	if (!incremental) {
+		broadphaseCollisions.Clear();
+	}
 
 	std::vector<GameObject*>::const_iterator first;
 	std::vector<GameObject*>::const_iterator last;
 	gameWorld.GetObjectIterators(first, last);
 
-	for (auto i = first; i != last; ++i) {
-		Vector3 halfSizes;
-		if (!(*i)->GetBroadphaseAABB(halfSizes)) {
-			continue;
-		}
-		Vector3 pos = (*i)->GetTransform().GetPosition();
-		tree.Insert(*i, pos, halfSizes);
+	broadPhase->UpdateProxies(first, last);
+	broadPhase->FindPairs(broadphaseCollisions);
+
+	if (!incremental) {
+		broadphaseCollisions.SortAndRemoveDuplicates();
 	}
 
-	tree.OperateOnContents([&](std::list<QuadTreeEntry<GameObject*>>& data) {
-		CollisionDetection::CollisionInfo info;
+	staticCollisions.Clear();
+	broadPhase->FindStaticPairs(staticCollisions);
+	staticCollisions.SortAndRemoveDuplicates();
+}
 
-		for (auto i = data.begin(); i != data.end(); ++i) {
-			for (auto j = std::next(i); j != data.end(); ++j) {
-				info.a = min((*i).object, (*j).object);
-				info.b = max((*i).object, (*j).object);
-				broadphaseCollisions.insert(info);
-			}
-		}
-	});
+const BroadPhasePair& PhysicsSystem::GetNarrowPhasePair(int index) const {
+	int movingCount = broadphaseCollisions.GetCount();
+	return index < movingCount ? broadphaseCollisions[index] : staticCollisions[index - movingCount];
 }
 
 void WinGame(GameObject& a, GameObject& b) {
@@ -349,114 +772,229 @@ void WinGame(GameObject& a, GameObject& b) {
 The broadphase will now only give us likely collisions, so we can now go through them,
 and work out if they are truly colliding, and if so, add them into the main collision list
 */
+//How many broadphase pairs a thread tests at a time
+const int narrowPhaseBlockSize = 64;
+
 void PhysicsSystem::NarrowPhase() {
-	for (std::set<CollisionDetection::CollisionInfo>::iterator i = broadphaseCollisions.begin(); i != broadphaseCollisions.end(); ++i) {
-		CollisionDetection::CollisionInfo info = *i;
+	int pairCount	= broadphaseCollisions.GetCount() + staticCollisions.GetCount();
+	int blockCount	= (pairCount + narrowPhaseBlockSize - 1) / narrowPhaseBlockSize;
+
+	threadResults.resize(workers->GetThreadCount());
+	threadBatches.resize(workers->GetThreadCount());
+	for (std::vector<NarrowPhaseResult>& results : threadResults) {
+		results.clear();
+	}
+	narrowPhaseBlocks.assign(blockCount, { -1, 0, 0 });
 
-		if (CollisionDetection::ObjectIntersection(info.a, info.b, info)) {
-			if (info.b->GetName() == "bonus") {
-				CollectBonus(*info.a, *info.b);
+	workers->ParallelFor(pairCount, narrowPhaseBlockSize, [&](int begin, int end, int thread) {
+		TestPairs(begin, end, thread);
+	});
+
+	//Results are merged in the order of the pairs, whichever threads found them,
+	//so the collision list and manifolds are always built up in the same order
+	for (const NarrowPhaseBlock& block : narrowPhaseBlocks) {
+		if (block.thread == -1) {
+			continue;
+		}
+		for (int i = 0; i < block.resultCount; ++i) {
+			NarrowPhaseResult& result = threadResults[block.thread][block.firstResult + i];
+			CollisionDetection::CollisionInfo& info = result.info;
+
+			if (result.cache.IsUsed()) {
+				result.cache.lastUpdate = substepCount;
+				*pairCaches.Insert(result.key, result.cache).first = result.cache;
+			}
+
+			if (result.asleep) {
+				KeepPairAsleep(result.key);
 				continue;
 			}
-			
-			if (info.a->GetName() == "finish" && (info.b->GetName() == "player1" || info.b->GetName() == "player2")) {
-				info.b->win = true;
+			if (!result.touching) {
+				continue;
 			}
-			else if ((info.a->GetName() == "player1" || info.a->GetName() == "player2") && info.b->GetName() == "finish") {
-				info.a->win = true;
+
+			if (result.sensor) {
+				UpdateSensorOverlap(result.key, info.a, info.b);
+				continue;
+			}
+
+			//Speculative contacts only stop the objects, they haven't actually hit anything yet
+			if (result.speculative) {
+				UpdateManifold(info);
+				continue;
 			}
-			info.framesLeft = numCollisionFrames;
-			ImpulseResolveCollision(*info.a, *info.b, info.point);
-			allCollisions.insert(info); // insert into our main set
+
+			UpdateManifold(info);
+			AddCollision(result.key, info); // insert into our main list
+		}
+	}
+
+	//Pairs that weren't tested this substep start from scratch next time
+	for (int i = 0; i < pairCaches.GetCount(); ) {
+		if (pairCaches[i].lastUpdate != substepCount) {
+			pairCaches.RemoveAt(i);
+		}
+		else {
+			++i;
 		}
 	}
 }
 
 /*
-Integration of acceleration and velocity is split up, so that we can
-move objects multiple times during the course of a PhysicsUpdate,
-without worrying about repeated forces accumulating etc. 
-
-This function will update both linear and angular acceleration,
-based on any forces that have been accumulated in the objects during
-the course of the previous game frame.
+The intersection tests for each broadphase pair don't depend on each other,
+so blocks of pairs are tested on whichever thread is free. Nothing in the
+world is changed here - each thread only writes to its own results.
+
+The awake pairs in a block are first run through the batched kernels, which
+throw away the ones that clearly aren't touching several at a time. The
+rest are then tested properly, still in the order the broadphase gave them.
+Pairs with a sensor in are only tested for whether they overlap at all.
 */
-void PhysicsSystem::IntegrateAccel(float dt) {
-	std::vector<GameObject*>::const_iterator first;
-	std::vector<GameObject*>::const_iterator last;
-	gameWorld.GetObjectIterators(first, last);
+void PhysicsSystem::TestPairs(int begin, int end, int thread) {
+	std::vector<NarrowPhaseResult>& results = threadResults[thread];
+	NarrowPhaseBlock& block = narrowPhaseBlocks[begin / narrowPhaseBlockSize];
+	block.thread		= thread;
+	block.firstResult	= (int)results.size();
+
+	NarrowPhaseBatch& batch = threadBatches[thread];
+	batch.Begin(end - begin);
+	for (int i = begin; i < end; ++i) {
+		const BroadPhasePair& pair = GetNarrowPhasePair(i);
+		if (!IsPairAsleep(pair.a, pair.b)) {
+			batch.AddPair(i - begin, pair.a, pair.b, SpeculativeMargin(pair.a, pair.b));
+		}
+	}
+	batch.Run();
 
-	for (auto i = first; i != last; ++i) {
-		PhysicsObject* object = (*i)->GetPhysicsObject();
-		
-		if (object == nullptr)
-			continue; // No physics object exists for this GameObject!
+	NarrowPhaseResult result;
+	for (int i = begin; i < end; ++i) {
+		const BroadPhasePair& pair = GetNarrowPhasePair(i);
 
-		float inverseMass = object->GetInverseMass();
-		
-		Vector3 linearVel = object->GetLinearVelocity();
-		Vector3 force = object->GetForce();
-		Vector3 accel = force * inverseMass;
+		NarrowPhaseBatch::Outcome outcome = batch.GetOutcome(i - begin);
+		if (outcome == NarrowPhaseBatch::Separate) {
+			continue;
+		}
+		result.key		= pair.key;
+		result.asleep	= outcome == NarrowPhaseBatch::Skipped;
+		result.cache	= CollisionDetection::PairCache();
+
+		result.sensor = IsSensorPair(pair.a, pair.b);
+		if (result.sensor) {
+			result.info.a	= pair.a;
+			result.info.b	= pair.b;
+			result.touching = result.asleep || CollisionDetection::OverlapTest(pair.a, pair.b);
+			if (result.touching) {
+				results.emplace_back(result);
+			}
+			continue;
+		}
 
-		if (applyGravity && inverseMass > 0)
-			accel += gravity; // don't move infinitely heavy things
+		//Nothing is added to the caches until the results are merged, so finding them here is safe
+		if (!result.asleep) {
+			if (CollisionDetection::PairCache* previous = pairCaches.Find(pair.key)) {
+				result.cache = *previous;
+			}
+		}
+		result.touching		= result.asleep || CollisionDetection::ObjectIntersection(pair.a, pair.b, result.info, &result.cache);
+		result.speculative	= false;
 
-		linearVel += accel * dt; // integrate acceleration!
-		object->SetLinearVelocity(linearVel);
+		if (!result.touching) {
+			if (float margin = SpeculativeMargin(pair.a, pair.b)) {
+				result.touching		= CollisionDetection::SpeculativeIntersection(pair.a, pair.b, margin, result.info, &result.cache);
+				result.speculative	= result.touching;
+			}
+		}
 
-		// Angular stuff
-		Vector3 torque = object->GetTorque();
-		Vector3 angVel = object->GetAngularVelocity();
+		if (result.touching || result.cache.IsUsed()) {
+			results.emplace_back(result);
+		}
+	}
+	block.resultCount = (int)results.size() - block.firstResult;
+}
 
-		object->UpdateInertiaTensor(); // update tensor vs orientation
+/*
+How far apart a pair can be and still be given speculative contacts - as
+far as they could move towards each other in a substep if one of them is
+continuous, and 0 otherwise. Spinning doesn't add to it, so a long object
+spinning quickly can still pass through things with its ends.
+*/
+float PhysicsSystem::SpeculativeMargin(GameObject* a, GameObject* b) const {
+	PhysicsObject* physA = a->GetPhysicsObject();
+	PhysicsObject* physB = b->GetPhysicsObject();
+	if (!physA || !physB || !(physA->IsContinuous() || physB->IsContinuous())) {
+		return 0.0f;
+	}
+	return (physA->GetLinearVelocity().Length() + physB->GetLinearVelocity().Length()) * fixedDT;
+}
 
-		Vector3 angAccel = object->GetInertiaTensor() * torque;
+/*
+Integration of acceleration and velocity is split up, so that we can
+move objects multiple times during the course of a PhysicsUpdate,
+without worrying about repeated forces accumulating etc. 
 
-		angVel += angAccel * dt;
-		object->SetAngularVelocity(angVel);
-	}
+This function will update both linear and angular acceleration,
+based on any forces that have been accumulated in the objects during
+the course of the previous game frame. Every object is done at once,
+several at a time, straight out of the RigidBodyPool's arrays.
+*/
+void PhysicsSystem::IntegrateAccel(float dt) {
+	bodyPool.IntegrateAccel(applyGravity ? gravity : Vector3(), dt, workers);
 }
 /*
 This function integrates linear and angular velocity into
 position and orientation. It may be called multiple times
 throughout a physics update, to slowly move the objects through
 the world, looking for collisions.
+
+The moved objects then have their Transforms updated, as that's
+where the collision detection will look for them.
 */
 void PhysicsSystem::IntegrateVelocity(float dt) {
+	float frameLinearDamping	= 1.0f - (GetLinearDamping() * dt);
+	float frameAngularDamping	= 1.0f - (0.4f * dt);
+
+	bodyPool.IntegrateVelocity(frameLinearDamping, frameAngularDamping, dt, workers);
+	bodyPool.ScatterTransforms(workers);
+
+	for (PhysicsObject* object : kinematicBodies) {
+		bodyPool.MoveKinematic(object->GetBodyHandle(), dt);
+	}
+}
+
+/*
+Before the first substep, every object in the world has its position and
+orientation copied into the RigidBodyPool, which picks up anything the
+game has moved since the last update. Objects seen for the first time are
+added to the pool here. Only the awake dynamic objects in this world are
+marked as active, so nothing else gets integrated. Static objects can't
+have been moved, so they're skipped altogether, and never need a place in
+the pool, and kinematic ones are gathered up to be moved separately.
+*/
+void PhysicsSystem::GatherBodies() {
 	std::vector<GameObject*>::const_iterator first;
 	std::vector<GameObject*>::const_iterator last;
 	gameWorld.GetObjectIterators(first, last);
-	float frameLinearDamping = 1.0f - (GetLinearDamping() * dt);
+
+	bodyPool.ClearActive();
+	kinematicBodies.clear();
 
 	for (auto i = first; i != last; ++i) {
 		PhysicsObject* object = (*i)->GetPhysicsObject();
-
-		if (object == nullptr)
+		if (object == nullptr || object->GetBodyType() == BodyType::Static) {
 			continue;
-
-		Transform& transform = (*i)->GetTransform();
-
-		Vector3 position = transform.GetPosition();
-		Vector3 linearVel = object->GetLinearVelocity();
-		position += linearVel * dt;
-		transform.SetPosition(position);
-
-		linearVel = linearVel * frameLinearDamping;
-		object->SetLinearVelocity(linearVel);
-
-		// Orientation stuff
-		Quaternion orientation = transform.GetOrientation();
-		Vector3 angVel = object->GetAngularVelocity();
-
-		orientation += (Quaternion(angVel * dt * 0.5f, 0.0f) * orientation);
-		orientation.Normalise();
-
-		transform.SetOrientation(orientation);
-
-		// Damp the angular velocity too
-		float frameAngularDamping = 1.0f - (0.4f * dt);
-		angVel *= frameAngularDamping;
-		object->SetAngularVelocity(angVel);
+		}
+		if (object->GetBodyPool() != &bodyPool) {
+			object->SetBodyPool(&bodyPool);
+		}
+		else {
+			bodyPool.GatherTransform(object->GetBodyHandle());
+		}
+		if (object->GetBodyType() == BodyType::Kinematic) {
+			kinematicBodies.emplace_back(object);
+		}
+		else if (!object->IsAsleep()) {
+			bodyPool.SetValue(RigidBodyPool::Active, object->GetBodyHandle(), 1.0f);
+		}
 	}
 }
 
@@ -481,12 +1019,22 @@ to constrain objects based on some extra calculation, allowing
 us to model springs and ropes etc. 
 
 */
-void PhysicsSystem::UpdateConstraints(float dt) {
+int PhysicsSystem::AddConstraintRows(float dt) {
 	std::vector<Constraint*>::const_iterator first;
 	std::vector<Constraint*>::const_iterator last;
 	gameWorld.GetConstraintIterators(first, last);
 
+	int added = 0;
 	for (auto i = first; i != last; ++i) {
-		(*i)->UpdateConstraint(dt);
+		GameObject* a = (*i)->GetObjectA();
+		GameObject* b = (*i)->GetObjectB();
+		if (IsPairAsleep(a, b)) {
+			continue;
+		}
+		int island = islands.GetIslandOf(a);
+		solver.SetIsland(island != -1 ? island : islands.GetIslandOf(b));
+		(*i)->AddRows(solver, dt);
+		added++;
 	}
+	return added;
 }
\ No newline at end of file
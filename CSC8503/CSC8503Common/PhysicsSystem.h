@@ -1,6 +1,18 @@
 #pragma once
 #include "../CSC8503Common/GameWorld.h"
-#include <set>
+#include "BroadPhaseStructure.h"
+#include "PairMap.h"
+#include "ContactManifold.h"
+#include "ConstraintSolver.h"
+#include "IslandBuilder.h"
+#include "WorkerPool.h"
+#include "NarrowPhaseBatch.h"
+#include "CollisionEvents.h"
+#include "PhysicsStats.h"
+#include "RigidBodyPool.h"
+#include "../../Common/GameTimer.h"
+#include <functional>
+#include <unordered_map>
 
 extern unsigned short players;
 
@@ -25,41 +37,207 @@ namespace NCL {
 
 			void SetGravity(const Vector3& g);
 
+			//How many times a second the world is stepped, however long each frame takes
+			void SetFixedRate(int hz);
+
+			int GetFixedRate() const {
+				return fixedHZ;
+			}
+
+			float GetFixedTimestep() const {
+				return fixedDT;
+			}
+
+			//Any time past this many substeps in a single update is dropped
+			void SetMaxSubsteps(int count) {
+				maxSubsteps = count < 1 ? 1 : count;
+			}
+
+			int GetMaxSubsteps() const {
+				return maxSubsteps;
+			}
+
+			//How far between the last two substeps the current time is, for blending rendered objects
+			float GetInterpolationAlpha() const {
+				return dTOffset / fixedDT;
+			}
+
 			float GetLinearDamping() const {
 				return linearDamping;
 			}
 			void SetLinearDamping(float d) {
 				linearDamping = d;
 			}
+
+			void SetBroadPhase(BroadPhaseType type);
+
+			BroadPhaseType GetBroadPhase() const {
+				return broadPhaseType;
+			}
+
+			//More iterations give stiffer stacks and joints, at the cost of more time
+			void SetSolverIterations(int velocity, int position) {
+				velocityIterations = velocity;
+				positionIterations = position;
+			}
+
+			int GetVelocityIterations() const {
+				return velocityIterations;
+			}
+
+			int GetPositionIterations() const {
+				return positionIterations;
+			}
+
+			//With more than 1 thread, separate islands are solved at the same time
+			void SetThreadCount(int count);
+
+			int GetThreadCount() const {
+				return workers->GetThreadCount();
+			}
+
+			void UseSleeping(bool state) {
+				allowSleeping = state;
+			}
+
+			//Called with true when something starts overlapping a sensor, and false when it stops
+			typedef std::function<void(GameObject* sensor, GameObject* other, bool entered)> SensorCallback;
+
+			//Listens to the sensor with the given world ID, until the system is cleared
+			void AddSensorListener(int sensorID, const SensorCallback& callback);
+
+			//Hands every event published since the last call to the objects and sensor listeners.
+			//Call once a frame after Update, unless the events are drained from the queue directly.
+			void DispatchCollisionEvents();
+
+			CollisionEventQueue& GetCollisionEvents() {
+				return collisionEvents;
+			}
+
+			//How long each of the last few substeps spent in each phase, and how much it had to do
+			const PhysicsStatsHistory& GetStats() const {
+				return stats;
+			}
+
+			//How many substeps of stats to keep, throwing away any kept so far
+			void SetStatsHistoryLength(int substeps) {
+				stats.SetCapacity(substeps);
+			}
+
+			//An island goes to sleep once all of its objects have been slower than these for long enough
+			void SetSleepThresholds(float linear, float angular, float time) {
+				linearSleepTolerance	= linear;
+				angularSleepTolerance	= angular;
+				timeToSleep				= time;
+			}
 		protected:
+			void UpdateDebugKeys();
+
 			void BasicCollisionDetection();
 			void BroadPhase();
 			void NarrowPhase();
+			void TestPairs(int begin, int end, int thread);
+			const BroadPhasePair& GetNarrowPhasePair(int index) const;
+			float SpeculativeMargin(GameObject* a, GameObject* b) const;
 
 			void ClearForces();
 
 			void IntegrateAccel(float dt);
 			void IntegrateVelocity(float dt);
+			void GatherBodies();
 
-			void UpdateConstraints(float dt);
+			int AddConstraintRows(float dt);	//returns how many constraints were added
 
+			void AddCollision(PairKey key, const CollisionDetection::CollisionInfo& info);
 			void UpdateCollisionList();
 			void UpdateObjectAABBs();
 
-			void ImpulseResolveCollision(GameObject& a , GameObject&b, CollisionDetection::ContactPoint& p) const;
+			void UpdateManifold(const CollisionDetection::CollisionInfo& info);
+			void RemoveStaleManifolds();
+			void AddContactRows(float dt);
+			int CountTouchingPoints() const;
+
+			void UpdateIslands();
+			void UpdateSleeping(float dt);
+			int CountAwakeBodies() const;
+			bool IsPairAsleep(GameObject* a, GameObject* b) const;
+			void KeepPairAsleep(PairKey key);
+
 			void ResolveSpringCollision(GameObject& a, GameObject& b, CollisionDetection::ContactPoint& p) const;
 
-			void CollectBonus(GameObject& a, GameObject& b) const;
+			bool IsSensorPair(GameObject* a, GameObject* b) const;
+			void UpdateSensorOverlap(PairKey key, GameObject* a, GameObject* b);
+			void RemoveStaleSensorOverlaps();
+			void QueueSensorEvents(GameObject* a, GameObject* b, bool entered);
+
+			//A pair with at least one sensor in it that's currently overlapping
+			struct SensorOverlap {
+				GameObject* a;
+				GameObject* b;
+				int			lastUpdate;
+			};
 
 			GameWorld& gameWorld;
 
 			bool	applyGravity;
 			Vector3 gravity;
 			float	dTOffset;
+			int		fixedHZ;
+			float	fixedDT;
+			int		maxSubsteps;
 			float	globalDamping;
 
-			std::set<CollisionDetection::CollisionInfo> allCollisions;
-			std::set<CollisionDetection::CollisionInfo> broadphaseCollisions;
+			PairMap<CollisionDetection::CollisionInfo> allCollisions;
+			PairMap<ContactManifold>	manifolds;
+			PairMap<CollisionDetection::PairCache> pairCaches;	//for pairs tested with GJK or SAT
+			PairMap<SensorOverlap>		sensorOverlaps;
+			std::unordered_map<int, std::vector<SensorCallback>> sensorListeners;	//keyed by the sensor's world ID
+			CollisionEventQueue			collisionEvents;
+			std::vector<CollisionEvent>	dispatchedEvents;
+			PairBuffer					broadphaseCollisions;
+			PairBuffer					staticCollisions;	//between moving and static objects
+			RigidBodyPool				bodyPool;	//every non-static object this system has updated
+			std::vector<PhysicsObject*>	kinematicBodies;
+			int							substepCount;
+
+			ConstraintSolver	solver;
+			int					velocityIterations;
+			int					positionIterations;
+
+			IslandBuilder	islands;
+			WorkerPool*		workers;
+
+			PhysicsStatsHistory	stats;
+			GameTimer			stepTimer;	//ticked between the phases of each substep
+
+			//What the narrowphase found for a single broadphase pair
+			struct NarrowPhaseResult {
+				CollisionDetection::CollisionInfo info;
+				PairKey		key;
+				bool		asleep;
+				bool		touching;
+				bool		speculative;	//touching within the margin, but not yet really
+				bool		sensor;			//only overlap tested, with no contact points
+				CollisionDetection::PairCache cache;	//left unused unless the pair was tested with GJK or SAT
+			};
+
+			//Which thread tested a block of broadphase pairs, and where its results went
+			struct NarrowPhaseBlock {
+				int thread;
+				int firstResult;
+				int resultCount;
+			};
+
+			std::vector<std::vector<NarrowPhaseResult>>	threadResults;
+			std::vector<NarrowPhaseBlock>				narrowPhaseBlocks;
+			std::vector<NarrowPhaseBatch>				threadBatches;
+			bool			allowSleeping;
+			float			linearSleepTolerance;
+			float			angularSleepTolerance;
+			float			timeToSleep;
+
+			BroadPhaseStructure*	broadPhase;
+			BroadPhaseType			broadPhaseType;
 
 			float linearDamping = 0.4f;
 			bool useBroadPhase = true;
@@ -1,35 +1,26 @@
 #include "GameObject.h"
 #include "PositionConstraint.h"
+#include "ConstraintSolver.h"
+#include <cfloat>
 
 using namespace NCL::CSC8503;
 
-void PositionConstraint::UpdateConstraint(float dt) {
-	Vector3 relativePos = objectA->GetTransform().GetPosition() - objectB->GetTransform().GetPosition();
+/*
+Keeps the centres of the two objects a fixed distance apart. The velocity
+row stops them moving towards or away from each other, while the position
+row pulls them back to the right distance if they have drifted.
+*/
+void PositionConstraint::AddRows(ConstraintSolver& solver, float dt) {
+	Vector3 relativePos = objectB->GetTransform().GetPosition() - objectA->GetTransform().GetPosition();
 	float currentDistance = relativePos.Length();
-	float offset = distance - currentDistance;
 
-	if (abs(offset) > 0.0f) {
-		Vector3 offsetDir = relativePos.Normalised();
+	if (currentDistance > 0.0f) {
+		Vector3 offsetDir = relativePos / currentDistance;
 
-		PhysicsObject* physA = objectA->GetPhysicsObject();
-		PhysicsObject* physB = objectB->GetPhysicsObject();
+		int a = solver.AddBody(objectA);
+		int b = solver.AddBody(objectB);
 
-		Vector3 relativeVelocity = physA->GetLinearVelocity() - physB->GetLinearVelocity();
-		float constraintMass = physA->GetInverseMass() + physB->GetInverseMass();
-
-		if (constraintMass > 0.0f) {
-			// how much of the relative force is affecting the constraint
-			float velocityDot = Vector3::Dot(relativeVelocity, offsetDir);
-			float biasFactor = 0.01f;
-			float bias = -(biasFactor / dt) * offset;
-
-			float lambda = -(velocityDot + bias) / constraintMass;
-
-			Vector3 aImpulse = offsetDir * lambda;
-			Vector3 bImpulse = -offsetDir * lambda;
-
-			physA->ApplyLinearImpulse(aImpulse); // multiplied by mass here
-			physB->ApplyLinearImpulse(bImpulse); // multiplied by mass here
-		}
+		solver.AddVelocityRow(a, b, offsetDir, Vector3(), Vector3(), 0.0f, -FLT_MAX, FLT_MAX, &impulse);
+		solver.AddPositionRow(a, b, offsetDir, currentDistance - distance, false);
 	}
-}
\ No newline at end of file
+}
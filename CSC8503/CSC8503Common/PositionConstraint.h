@@ -7,18 +7,16 @@ namespace NCL {
 
 		class PositionConstraint : public Constraint {
 		public:
-			PositionConstraint(GameObject* a, GameObject* b, float d) {
-				objectA = a;
-				objectB = b;
+			PositionConstraint(GameObject* a, GameObject* b, float d) : Constraint(a, b) {
 				distance = d;
+				impulse = 0.0f;
 			}
 			~PositionConstraint() {}
 
-			void UpdateConstraint(float dt) override;
+			void AddRows(ConstraintSolver& solver, float dt) override;
 		protected:
-			GameObject* objectA;
-			GameObject* objectB;
 			float distance;
+			float impulse; //kept between substeps for warm starting
 		};
 	}
 }
\ No newline at end of file
@@ -0,0 +1,240 @@
+#include "QuadTreeBroadPhase.h"
+#include "GameObject.h"
+#include <algorithm>
+
+using namespace NCL;
+using namespace CSC8503;
+
+QuadTreeBroadPhase::QuadTreeBroadPhase(const Vector2& size, int maxDepth, int maxSize) {
+	this->size		= size;
+	this->maxDepth	= maxDepth;
+	this->maxSize	= maxSize;
+	Clear();
+}
+
+QuadTreeBroadPhase::~QuadTreeBroadPhase() {
+}
+
+/*
+Clearing keeps the capacity of the node and proxy pools around, so
+resetting the world doesn't cause them to be allocated all over again.
+*/
+void QuadTreeBroadPhase::ClearProxies() {
+	proxyPool.clear();
+	freeProxies.clear();
+	freeChildren.clear();
+	pendingMerges.clear();
+
+	nodes.resize(1);
+	nodes[0].position	= Vector2();
+	nodes[0].size		= size;
+	nodes[0].parent		= -1;
+	nodes[0].children	= -1;
+	nodes[0].depth		= 0;
+	nodes[0].contents.clear();
+}
+
+int QuadTreeBroadPhase::AddProxy(GameObject* object, const Vector3& position, const Vector3& halfSize) {
+	int index;
+	if (!freeProxies.empty()) {
+		index = freeProxies.back();
+		freeProxies.pop_back();
+	}
+	else {
+		index = (int)proxyPool.size();
+		proxyPool.emplace_back();
+	}
+	Proxy& p	= proxyPool[index];
+	p.object	= object;
+	p.position	= position;
+	p.halfSize	= halfSize;
+	p.leaves.clear();
+
+	Insert(0, index);
+	return index;
+}
+
+void QuadTreeBroadPhase::MoveProxy(int handle, const Vector3& position, const Vector3& halfSize) {
+	Unlink(handle);
+	proxyPool[handle].position = position;
+	proxyPool[handle].halfSize = halfSize;
+	Insert(0, handle);
+}
+
+void QuadTreeBroadPhase::RemoveProxy(int handle) {
+	Unlink(handle);
+	proxyPool[handle].object = nullptr;
+	freeProxies.emplace_back(handle);
+}
+
+//Same test as the original QuadTreeNode::Insert, which only cares about the XZ plane
+bool QuadTreeBroadPhase::Overlaps(const Node& n, const Proxy& p) const {
+	return	abs(p.position.x - n.position.x) < (p.halfSize.x + n.size.x) &&
+			abs(p.position.z - n.position.y) < (p.halfSize.z + n.size.y);
+}
+
+/*
+Note that nodes are always referred to by index here, as splitting a
+node can grow the pool, and invalidate any references into it.
+*/
+void QuadTreeBroadPhase::Insert(int nodeIndex, int proxyIndex) {
+	if (!Overlaps(nodes[nodeIndex], proxyPool[proxyIndex])) {
+		return;
+	}
+	int children = nodes[nodeIndex].children;
+	if (children >= 0) { // not a leaf node, just descend the tree
+		for (int i = 0; i < 4; ++i) {
+			Insert(children + i, proxyIndex);
+		}
+		return;
+	}
+	nodes[nodeIndex].contents.emplace_back(proxyIndex);
+	proxyPool[proxyIndex].leaves.emplace_back(nodeIndex);
+
+	if ((int)nodes[nodeIndex].contents.size() > maxSize && nodes[nodeIndex].depth < maxDepth) {
+		Split(nodeIndex);
+	}
+}
+
+/*
+Removes a proxy from every leaf it is currently in. Leaves that might now
+be worth collapsing back into their parent are remembered, and merged the
+next time pairs are generated, so an object moving around inside a busy
+node doesn't cause it to repeatedly merge and split.
+*/
+void QuadTreeBroadPhase::Unlink(int proxyIndex) {
+	Proxy& p = proxyPool[proxyIndex];
+	for (int leaf : p.leaves) {
+		std::vector<int>& contents = nodes[leaf].contents;
+		auto found = std::find(contents.begin(), contents.end(), proxyIndex);
+		if (found != contents.end()) {
+			*found = contents.back();
+			contents.pop_back();
+		}
+		if (nodes[leaf].parent >= 0) {
+			pendingMerges.emplace_back(nodes[leaf].parent);
+		}
+	}
+	p.leaves.clear();
+}
+
+int QuadTreeBroadPhase::AllocateChildren() {
+	if (!freeChildren.empty()) {
+		int index = freeChildren.back();
+		freeChildren.pop_back();
+		return index;
+	}
+	int index = (int)nodes.size();
+	nodes.resize(nodes.size() + 4);
+	return index;
+}
+
+void QuadTreeBroadPhase::Split(int nodeIndex) {
+	int children = AllocateChildren();
+
+	Vector2 halfSize	= nodes[nodeIndex].size / 2.0f;
+	Vector2 position	= nodes[nodeIndex].position;
+	Vector2 offsets[4]	= {
+		Vector2(-halfSize.x, halfSize.y), Vector2(halfSize.x, halfSize.y),
+		Vector2(-halfSize.x, -halfSize.y), Vector2(halfSize.x, -halfSize.y)
+	};
+
+	for (int i = 0; i < 4; ++i) {
+		Node& child		= nodes[children + i];
+		child.position	= position + offsets[i];
+		child.size		= halfSize;
+		child.parent	= nodeIndex;
+		child.children	= -1;
+		child.depth		= nodes[nodeIndex].depth + 1;
+		child.contents.clear();
+	}
+	nodes[nodeIndex].children = children;
+
+	// we need to reinsert the contents so far. Children can split in turn,
+	// so this can't share a scratch buffer with the rest of the tree
+	std::vector<int> contents;
+	contents.swap(nodes[nodeIndex].contents);
+
+	for (int p : contents) {
+		std::vector<int>& leaves = proxyPool[p].leaves;
+		leaves.erase(std::remove(leaves.begin(), leaves.end(), nodeIndex), leaves.end());
+		for (int i = 0; i < 4; ++i) {
+			Insert(children + i, p);
+		}
+	}
+	//Give the node its old storage back, so it can be reused if it is merged again
+	contents.clear();
+	nodes[nodeIndex].contents.swap(contents);
+}
+
+/*
+If all four children of a node are leaves, and between them they hold few
+enough proxies, they are collapsed back into their parent. The threshold is
+half of the split size, so that a node sitting right on the limit doesn't
+flip between the two states every update.
+*/
+void QuadTreeBroadPhase::TryMerge(int nodeIndex) {
+	int children = nodes[nodeIndex].children;
+	if (children < 0) {
+		return;
+	}
+	mergeScratch.clear();
+	for (int i = 0; i < 4; ++i) {
+		if (nodes[children + i].children >= 0) {
+			return;
+		}
+		for (int p : nodes[children + i].contents) {
+			if (std::find(mergeScratch.begin(), mergeScratch.end(), p) == mergeScratch.end()) {
+				mergeScratch.emplace_back(p);
+			}
+		}
+		if ((int)mergeScratch.size() > maxSize / 2) {
+			return;
+		}
+	}
+
+	for (int p : mergeScratch) {
+		std::vector<int>& leaves = proxyPool[p].leaves;
+		leaves.erase(std::remove_if(leaves.begin(), leaves.end(), [&](int leaf) {
+			return leaf >= children && leaf < children + 4;
+		}), leaves.end());
+		leaves.emplace_back(nodeIndex);
+	}
+	for (int i = 0; i < 4; ++i) {
+		nodes[children + i].contents.clear();
+		nodes[children + i].children = -1;
+	}
+	nodes[nodeIndex].contents.assign(mergeScratch.begin(), mergeScratch.end());
+	nodes[nodeIndex].children = -1;
+	freeChildren.emplace_back(children);
+
+	if (nodes[nodeIndex].parent >= 0) {
+		TryMerge(nodes[nodeIndex].parent);
+	}
+}
+
+/*
+Leaves are stored in one flat pool, so we can just walk over it rather than
+recursing down from the root. Freed nodes have no contents, so are skipped.
+*/
+void QuadTreeBroadPhase::FindPairs(PairBuffer& pairs) {
+	for (int n : pendingMerges) {
+		TryMerge(n);
+	}
+	pendingMerges.clear();
+
+	for (const Node& n : nodes) {
+		if (n.children >= 0) {
+			continue;
+		}
+		for (size_t i = 0; i < n.contents.size(); ++i) {
+			GameObject* a = proxyPool[n.contents[i]].object;
+			for (size_t j = i + 1; j < n.contents.size(); ++j) {
+				GameObject* b = proxyPool[n.contents[j]].object;
+				if (CanCollide(a, b)) {
+					pairs.Add(a, b);
+				}
+			}
+		}
+	}
+}
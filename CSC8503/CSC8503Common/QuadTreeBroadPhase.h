@@ -0,0 +1,68 @@
+#pragma once
+#include "BroadPhaseStructure.h"
+#include "../../Common/Vector2.h"
+#include <vector>
+
+namespace NCL {
+	namespace CSC8503 {
+		/*
+		A persistent version of the QuadTree used by the original broadphase.
+		Nodes live in a single pool that is reused between updates, and split
+		or merge in place as proxies move, instead of the whole tree being
+		thrown away and rebuilt every physics substep.
+		*/
+		class QuadTreeBroadPhase : public BroadPhaseStructure	{
+		public:
+			QuadTreeBroadPhase(const Vector2& size = Vector2(1024, 1024), int maxDepth = 7, int maxSize = 6);
+			~QuadTreeBroadPhase();
+
+			void FindPairs(PairBuffer& pairs) override;
+
+			int GetNodeCount() const {
+				return (int)nodes.size() - (int)(freeChildren.size() * 4);
+			}
+
+		protected:
+			struct Node {
+				Vector2 position;
+				Vector2 size;
+				int		parent;
+				int		children; //index of the first of 4 contiguous children, or -1 for a leaf
+				int		depth;
+				std::vector<int> contents;
+			};
+
+			struct Proxy {
+				GameObject* object;
+				Vector3		position;
+				Vector3		halfSize;
+				std::vector<int> leaves;
+			};
+
+			void	ClearProxies() override;
+			int		AddProxy(GameObject* object, const Vector3& position, const Vector3& halfSize) override;
+			void	MoveProxy(int handle, const Vector3& position, const Vector3& halfSize) override;
+			void	RemoveProxy(int handle) override;
+
+			void	Insert(int nodeIndex, int proxyIndex);
+			void	Unlink(int proxyIndex);
+			void	Split(int nodeIndex);
+			void	TryMerge(int nodeIndex);
+			int		AllocateChildren();
+
+			bool	Overlaps(const Node& n, const Proxy& p) const;
+
+			std::vector<Node>	nodes;
+			std::vector<int>	freeChildren;
+			std::vector<int>	pendingMerges;
+			std::vector<int>	mergeScratch;
+
+			std::vector<Proxy>	proxyPool;
+			std::vector<int>	freeProxies;
+
+			Vector2 size;
+			int		maxDepth;
+			int		maxSize;
+		};
+	}
+}
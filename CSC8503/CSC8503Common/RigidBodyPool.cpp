@@ -0,0 +1,349 @@
+#include "RigidBodyPool.h"
+#include "Transform.h"
+#include "WorkerPool.h"
+#include "SimdFloat.h"
+#include <cstdint>
+#include <cstring>
+
+using namespace NCL;
+using namespace CSC8503;
+using namespace Simd;
+
+namespace {
+	inline SimdVector3 Cross(const SimdVector3& a, const SimdVector3& b) {
+		return {
+			Sub(Mul(a.y, b.z), Mul(a.z, b.y)),
+			Sub(Mul(a.z, b.x), Mul(a.x, b.z)),
+			Sub(Mul(a.x, b.y), Mul(a.y, b.x))
+		};
+	}
+
+	//v + 2w(q x v) + 2(q x (q x v)), the same as q * v * q.Conjugate() for a unit quaternion
+	inline SimdVector3 Rotate(const SimdVector3& q, SimdFloat w, const SimdVector3& v) {
+		SimdFloat two = Splat(2.0f);
+		SimdVector3 t = Cross(q, v);
+		t = { Mul(t.x, two), Mul(t.y, two), Mul(t.z, two) };
+		SimdVector3 u = Cross(q, t);
+		return {
+			Add(v.x, Add(Mul(w, t.x), u.x)),
+			Add(v.y, Add(Mul(w, t.y), u.y)),
+			Add(v.z, Add(Mul(w, t.z), u.z))
+		};
+	}
+
+	const int bodiesPerJob = 512;
+}
+
+RigidBodyPool::RigidBodyPool() {
+	data		= nullptr;
+	capacity	= 0;
+	bodyCount	= 0;
+}
+
+RigidBodyPool::~RigidBodyPool() {
+}
+
+int RigidBodyPool::AddBody(Transform* transform) {
+	int body;
+	if (!freeBodies.empty()) {
+		body = freeBodies.back();
+		freeBodies.pop_back();
+	}
+	else {
+		if (bodyCount == capacity) {
+			Grow();
+		}
+		body = bodyCount++;
+	}
+	transforms[body] = transform;
+	GatherTransform(body);
+	return body;
+}
+
+void RigidBodyPool::RemoveBody(int body) {
+	ClearBody(body);
+	transforms[body] = nullptr;
+	freeBodies.emplace_back(body);
+}
+
+/*
+Every component array is moved across to a new block twice the size.
+The new slots, and the padding past the last body, are all left empty,
+with an identity orientation so that the kernels can chew through them
+without producing anything nasty.
+*/
+void RigidBodyPool::Grow() {
+	int newCapacity = capacity == 0 ? 256 : capacity * 2;
+
+	std::vector<float> newStorage(ComponentCount * newCapacity + LaneCount);
+	uintptr_t address	= (uintptr_t)newStorage.data();
+	uintptr_t alignment = LaneCount * sizeof(float);
+	float* newData		= (float*)((address + alignment - 1) & ~(alignment - 1));
+
+	for (int c = 0; c < ComponentCount; ++c) {
+		if (capacity > 0) {
+			memcpy(newData + c * newCapacity, data + c * capacity, capacity * sizeof(float));
+		}
+	}
+	storage.swap(newStorage);
+	data = newData;
+
+	int oldCapacity = capacity;
+	capacity = newCapacity;
+	transforms.resize(capacity, nullptr);
+
+	for (int i = oldCapacity; i < capacity; ++i) {
+		ClearBody(i);
+	}
+}
+
+void RigidBodyPool::ClearBody(int body) {
+	for (int c = 0; c < ComponentCount; ++c) {
+		SetValue((Component)c, body, 0.0f);
+	}
+	SetValue(OrientationW, body, 1.0f);
+	SetValue(PreviousOrientationW, body, 1.0f);
+}
+
+Quaternion RigidBodyPool::GetOrientation(int body) const {
+	return Quaternion(GetValue(OrientationX, body), GetValue(OrientationY, body),
+		GetValue(OrientationZ, body), GetValue(OrientationW, body));
+}
+
+Quaternion RigidBodyPool::GetPreviousOrientation(int body) const {
+	return Quaternion(GetValue(PreviousOrientationX, body), GetValue(PreviousOrientationY, body),
+		GetValue(PreviousOrientationZ, body), GetValue(PreviousOrientationW, body));
+}
+
+void RigidBodyPool::ClearActive() {
+	memset(data + Active * capacity, 0, capacity * sizeof(float));
+}
+
+/*
+A body that the game has moved since the last substep has jumped there, so
+there's nothing sensible to blend from, and its previous state is moved too.
+*/
+void RigidBodyPool::GatherTransform(int body) {
+	const Transform* transform = transforms[body];
+	Vector3		position	= transform->GetPosition();
+	Quaternion	orientation = transform->GetOrientation();
+	Quaternion	current		= GetOrientation(body);
+
+	bool moved = GetVector(PositionX, body) != position || current.x != orientation.x ||
+		current.y != orientation.y || current.z != orientation.z || current.w != orientation.w;
+
+	SetVector(PositionX, body, position);
+	SetValue(OrientationX, body, orientation.x);
+	SetValue(OrientationY, body, orientation.y);
+	SetValue(OrientationZ, body, orientation.z);
+	SetValue(OrientationW, body, orientation.w);
+
+	if (moved) {
+		for (int c = PositionX; c <= OrientationW; ++c) {
+			SetValue((Component)(PreviousPositionX + c - PositionX), body, GetValue((Component)c, body));
+		}
+	}
+}
+
+//The position and orientation arrays are all next to each other, in the same order as the previous ones
+void RigidBodyPool::StorePreviousTransforms() {
+	memcpy(data + PreviousPositionX * capacity, data + PositionX * capacity, (OrientationW - PositionX + 1) * capacity * sizeof(float));
+}
+
+/*
+Objects with no mass only move if something has given them a velocity,
+so those sitting still don't need their matrices rebuilding every substep.
+*/
+void RigidBodyPool::ScatterTransforms(WorkerPool* workers) {
+	auto scatter = [&](int first, int last, int thread) {
+		for (int i = first; i < last; ++i) {
+			if (GetValue(Active, i) == 0.0f) {
+				continue;
+			}
+			Vector3 linearVelocity	= GetVector(LinearVelocityX, i);
+			Vector3 angularVelocity = GetVector(AngularVelocityX, i);
+			if (GetValue(InverseMass, i) == 0.0f && linearVelocity == Vector3() && angularVelocity == Vector3()) {
+				continue;
+			}
+			Transform* transform = transforms[i];
+			transform->SetPosition(GetVector(PositionX, i));
+			transform->SetOrientation(GetOrientation(i));
+		}
+	};
+	if (workers) {
+		workers->ParallelFor(bodyCount, bodiesPerJob, scatter);
+	}
+	else {
+		scatter(0, bodyCount, 0);
+	}
+}
+
+void RigidBodyPool::IntegrateAccel(const Vector3& gravity, float dt, WorkerPool* workers) {
+	int paddedCount = (bodyCount + LaneCount - 1) / LaneCount * LaneCount;
+	if (workers) {
+		workers->ParallelFor(paddedCount, bodiesPerJob, [&](int first, int last, int thread) {
+			IntegrateAccel(first, last, gravity, dt);
+		});
+	}
+	else {
+		IntegrateAccel(0, paddedCount, gravity, dt);
+	}
+}
+
+void RigidBodyPool::IntegrateVelocity(float linearDamping, float angularDamping, float dt, WorkerPool* workers) {
+	int paddedCount = (bodyCount + LaneCount - 1) / LaneCount * LaneCount;
+	if (workers) {
+		workers->ParallelFor(paddedCount, bodiesPerJob, [&](int first, int last, int thread) {
+			IntegrateVelocity(first, last, linearDamping, angularDamping, dt);
+		});
+	}
+	else {
+		IntegrateVelocity(0, paddedCount, linearDamping, angularDamping, dt);
+	}
+}
+
+/*
+Kinematic bodies are few and far between, so they're moved one at a time,
+rather than being given a lane in the kernels. Nothing slows them down, so
+they keep to whatever path the game is steering them along.
+*/
+void RigidBodyPool::MoveKinematic(int body, float dt) {
+	Vector3 linearVelocity	= GetVector(LinearVelocityX, body);
+	Vector3 angularVelocity = GetVector(AngularVelocityX, body);
+	if (linearVelocity == Vector3() && angularVelocity == Vector3()) {
+		return;
+	}
+	SetVector(PositionX, body, GetVector(PositionX, body) + linearVelocity * dt);
+
+	Quaternion orientation = GetOrientation(body);
+	orientation = orientation + (Quaternion(angularVelocity * dt * 0.5f, 0.0f) * orientation);
+	orientation.Normalise();
+	SetValue(OrientationX, body, orientation.x);
+	SetValue(OrientationY, body, orientation.y);
+	SetValue(OrientationZ, body, orientation.z);
+	SetValue(OrientationW, body, orientation.w);
+
+	Transform* transform = transforms[body];
+	transform->SetPosition(GetVector(PositionX, body));
+	transform->SetOrientation(orientation);
+}
+
+/*
+Adds on the acceleration from each body's forces, and from gravity if it
+has any mass. Torque is taken into the body's local space, scaled by the
+diagonal inverse inertia, and brought back out again, which is the same
+as multiplying by the world space inverse inertia tensor, without ever
+having to build it.
+
+Bodies that aren't active are still worked out, but their results are
+thrown away rather than stored.
+*/
+void RigidBodyPool::IntegrateAccel(int first, int last, const Vector3& gravity, float dt) {
+	SimdFloat zero		= Splat(0.0f);
+	SimdFloat step		= Splat(dt);
+	SimdFloat gravityX	= Splat(gravity.x);
+	SimdFloat gravityY	= Splat(gravity.y);
+	SimdFloat gravityZ	= Splat(gravity.z);
+
+	float* lvx = data + LinearVelocityX * capacity;
+	float* lvy = data + LinearVelocityY * capacity;
+	float* lvz = data + LinearVelocityZ * capacity;
+	float* avx = data + AngularVelocityX * capacity;
+	float* avy = data + AngularVelocityY * capacity;
+	float* avz = data + AngularVelocityZ * capacity;
+
+	for (int i = first; i < last; i += SimdWidth) {
+		SimdFloat active	= Greater(Load(data + Active * capacity + i), zero);
+		SimdFloat invMass	= Load(data + InverseMass * capacity + i);
+		SimdFloat hasMass	= Greater(invMass, zero);
+
+		SimdFloat accelX = Add(Mul(Load(data + ForceX * capacity + i), invMass), Select(hasMass, gravityX, zero));
+		SimdFloat accelY = Add(Mul(Load(data + ForceY * capacity + i), invMass), Select(hasMass, gravityY, zero));
+		SimdFloat accelZ = Add(Mul(Load(data + ForceZ * capacity + i), invMass), Select(hasMass, gravityZ, zero));
+
+		SimdFloat vx = Load(lvx + i);
+		SimdFloat vy = Load(lvy + i);
+		SimdFloat vz = Load(lvz + i);
+		Store(lvx + i, Select(active, Add(vx, Mul(accelX, step)), vx));
+		Store(lvy + i, Select(active, Add(vy, Mul(accelY, step)), vy));
+		Store(lvz + i, Select(active, Add(vz, Mul(accelZ, step)), vz));
+
+		SimdVector3 q		= { Load(data + OrientationX * capacity + i), Load(data + OrientationY * capacity + i), Load(data + OrientationZ * capacity + i) };
+		SimdFloat	qw		= Load(data + OrientationW * capacity + i);
+		SimdVector3 inverse = { Sub(zero, q.x), Sub(zero, q.y), Sub(zero, q.z) };
+		SimdVector3 torque	= { Load(data + TorqueX * capacity + i), Load(data + TorqueY * capacity + i), Load(data + TorqueZ * capacity + i) };
+
+		SimdVector3 local = Rotate(inverse, qw, torque);
+		local.x = Mul(local.x, Load(data + InverseInertiaX * capacity + i));
+		local.y = Mul(local.y, Load(data + InverseInertiaY * capacity + i));
+		local.z = Mul(local.z, Load(data + InverseInertiaZ * capacity + i));
+		SimdVector3 angAccel = Rotate(q, qw, local);
+
+		SimdFloat wx = Load(avx + i);
+		SimdFloat wy = Load(avy + i);
+		SimdFloat wz = Load(avz + i);
+		Store(avx + i, Select(active, Add(wx, Mul(angAccel.x, step)), wx));
+		Store(avy + i, Select(active, Add(wy, Mul(angAccel.y, step)), wy));
+		Store(avz + i, Select(active, Add(wz, Mul(angAccel.z, step)), wz));
+	}
+}
+
+/*
+Moves each body along by its velocity, and spins its orientation by its
+angular velocity, using the same q += (w * dt / 2) * q update as before,
+followed by a renormalise. Both velocities are then damped.
+*/
+void RigidBodyPool::IntegrateVelocity(int first, int last, float linearDamping, float angularDamping, float dt) {
+	SimdFloat zero			= Splat(0.0f);
+	SimdFloat step			= Splat(dt);
+	SimdFloat halfStep		= Splat(dt * 0.5f);
+	SimdFloat linearScale	= Splat(linearDamping);
+	SimdFloat angularScale	= Splat(angularDamping);
+
+	float* position[3]		= { data + PositionX * capacity, data + PositionY * capacity, data + PositionZ * capacity };
+	float* linear[3]		= { data + LinearVelocityX * capacity, data + LinearVelocityY * capacity, data + LinearVelocityZ * capacity };
+	float* angular[3]		= { data + AngularVelocityX * capacity, data + AngularVelocityY * capacity, data + AngularVelocityZ * capacity };
+	float* orientation[4]	= { data + OrientationX * capacity, data + OrientationY * capacity, data + OrientationZ * capacity, data + OrientationW * capacity };
+
+	for (int i = first; i < last; i += SimdWidth) {
+		SimdFloat active = Greater(Load(data + Active * capacity + i), zero);
+
+		for (int axis = 0; axis < 3; ++axis) {
+			SimdFloat p = Load(position[axis] + i);
+			SimdFloat v = Load(linear[axis] + i);
+			Store(position[axis] + i, Select(active, Add(p, Mul(v, step)), p));
+			Store(linear[axis] + i, Select(active, Mul(v, linearScale), v));
+		}
+
+		SimdFloat qx = Load(orientation[0] + i);
+		SimdFloat qy = Load(orientation[1] + i);
+		SimdFloat qz = Load(orientation[2] + i);
+		SimdFloat qw = Load(orientation[3] + i);
+
+		SimdFloat wx = Load(angular[0] + i);
+		SimdFloat wy = Load(angular[1] + i);
+		SimdFloat wz = Load(angular[2] + i);
+		SimdFloat hx = Mul(wx, halfStep);
+		SimdFloat hy = Mul(wy, halfStep);
+		SimdFloat hz = Mul(wz, halfStep);
+
+		//Quaternion(h, 0) * q
+		SimdFloat nx = Add(qx, Sub(Add(Mul(hx, qw), Mul(hy, qz)), Mul(hz, qy)));
+		SimdFloat ny = Add(qy, Sub(Add(Mul(hy, qw), Mul(hz, qx)), Mul(hx, qz)));
+		SimdFloat nz = Add(qz, Sub(Add(Mul(hz, qw), Mul(hx, qy)), Mul(hy, qx)));
+		SimdFloat nw = Sub(qw, Add(Add(Mul(hx, qx), Mul(hy, qy)), Mul(hz, qz)));
+
+		SimdFloat length = Sqrt(Add(Add(Mul(nx, nx), Mul(ny, ny)), Add(Mul(nz, nz), Mul(nw, nw))));
+		SimdFloat moved	 = Select(Greater(length, zero), active, zero);
+		length = Select(moved, length, Splat(1.0f));
+
+		Store(orientation[0] + i, Select(moved, Div(nx, length), qx));
+		Store(orientation[1] + i, Select(moved, Div(ny, length), qy));
+		Store(orientation[2] + i, Select(moved, Div(nz, length), qz));
+		Store(orientation[3] + i, Select(moved, Div(nw, length), qw));
+
+		Store(angular[0] + i, Select(active, Mul(wx, angularScale), wx));
+		Store(angular[1] + i, Select(active, Mul(wy, angularScale), wy));
+		Store(angular[2] + i, Select(active, Mul(wz, angularScale), wz));
+	}
+}
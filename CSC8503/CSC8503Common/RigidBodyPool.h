@@ -0,0 +1,125 @@
+#pragma once
+#include "../../Common/Vector3.h"
+#include "../../Common/Quaternion.h"
+#include <vector>
+
+namespace NCL {
+	using namespace NCL::Maths;
+	namespace CSC8503 {
+		class Transform;
+		class WorkerPool;
+
+		/*
+		Everything the integrator reads and writes for every PhysicsObject,
+		kept as a structure of arrays - one array of floats per component,
+		with a body's state found at the same index in each of them. The
+		integration kernels can then load the same component of a whole row
+		of bodies with a single aligned SIMD load.
+
+		Each PhysicsSystem has a pool of its own, which a PhysicsObject is
+		added to the first time that system updates it. From then on the
+		object only keeps a handle into the pool, and reads and writes its
+		velocities, forces and so on through it.
+
+		Transforms are still where positions and orientations live as far as
+		collision detection and rendering are concerned, so they are copied
+		into the pool at the start of each physics update, and the moved ones
+		are written back out after each substep's integration.
+		*/
+		class RigidBodyPool	{
+		public:
+			enum Component {
+				PositionX, PositionY, PositionZ,
+				OrientationX, OrientationY, OrientationZ, OrientationW,
+				LinearVelocityX, LinearVelocityY, LinearVelocityZ,
+				AngularVelocityX, AngularVelocityY, AngularVelocityZ,
+				ForceX, ForceY, ForceZ,
+				TorqueX, TorqueY, TorqueZ,
+				InverseInertiaX, InverseInertiaY, InverseInertiaZ,	//local space, diagonal
+				InverseMass,
+				Active,		//1 for awake dynamic bodies in the world being updated, 0 for everything else
+				PreviousPositionX, PreviousPositionY, PreviousPositionZ,	//where the body was before the last substep
+				PreviousOrientationX, PreviousOrientationY, PreviousOrientationZ, PreviousOrientationW,
+				ComponentCount
+			};
+
+			//Every array is padded out to a multiple of this, so the kernels never need a scalar tail
+			static const int LaneCount = 8;
+
+			RigidBodyPool();
+			~RigidBodyPool();
+
+			RigidBodyPool(const RigidBodyPool&) = delete;
+			RigidBodyPool& operator=(const RigidBodyPool&) = delete;
+
+			int  AddBody(Transform* transform);
+			void RemoveBody(int body);
+
+			float GetValue(Component c, int body) const {
+				return data[c * capacity + body];
+			}
+
+			void SetValue(Component c, int body, float value) {
+				data[c * capacity + body] = value;
+			}
+
+			Vector3 GetVector(Component first, int body) const {
+				const float* p = data + first * capacity + body;
+				return Vector3(p[0], p[capacity], p[capacity * 2]);
+			}
+
+			void SetVector(Component first, int body, const Vector3& v) {
+				float* p = data + first * capacity + body;
+				p[0]			= v.x;
+				p[capacity]		= v.y;
+				p[capacity * 2] = v.z;
+			}
+
+			void AddVector(Component first, int body, const Vector3& v) {
+				float* p = data + first * capacity + body;
+				p[0]			+= v.x;
+				p[capacity]		+= v.y;
+				p[capacity * 2] += v.z;
+			}
+
+			Quaternion GetOrientation(int body) const;
+			Quaternion GetPreviousOrientation(int body) const;
+
+			//Marks every body as inactive, ready for the world's awake bodies to be gathered
+			void ClearActive();
+
+			//Copies a body's position and orientation in from its Transform
+			void GatherTransform(int body);
+
+			//Keeps where every body is now, so the renderer can blend from it to where the next substep puts them
+			void StorePreviousTransforms();
+
+			//Copies the position and orientation of every active, moving body out to its Transform
+			void ScatterTransforms(WorkerPool* workers = nullptr);
+
+			void IntegrateAccel(const Vector3& gravity, float dt, WorkerPool* workers = nullptr);
+			void IntegrateVelocity(float linearDamping, float angularDamping, float dt, WorkerPool* workers = nullptr);
+
+			//Moves an inactive body along by its velocity, with no damping, and copies it out to its Transform
+			void MoveKinematic(int body, float dt);
+
+			int GetBodyCount() const {
+				return bodyCount;
+			}
+
+		protected:
+			void Grow();
+			void ClearBody(int body);
+
+			void IntegrateAccel(int first, int last, const Vector3& gravity, float dt);
+			void IntegrateVelocity(int first, int last, float linearDamping, float angularDamping, float dt);
+
+			std::vector<float>		storage;	//over allocated, so that data can be aligned
+			float*					data;		//ComponentCount arrays of capacity floats
+			int						capacity;
+			int						bodyCount;	//highest handle handed out so far, plus 1
+			std::vector<int>		freeBodies;
+			std::vector<Transform*>	transforms;
+		};
+	}
+}
@@ -1,187 +1,326 @@
 #include "SATAlgorithm.h"
-#include "Debug.h"
-using namespace NCL;
-#include "Transform.h"
+#include <cmath>
+#include <cfloat>
 
+using namespace NCL;
 using namespace Maths;
 using namespace CSC8503;
 
-SATAlgorithm::SATAlgorithm()
-{
-}
-
-
-SATAlgorithm::~SATAlgorithm()
-{
-}
-
-bool SATAlgorithm::BoundingBoxSAT(const NCL::OBBVolume& volumeA, const Transform& worldTransformA,
-	const NCL::OBBVolume& volumeB, const Transform& worldTransformB, CollisionDetection::CollisionInfo& collisionInfo
-) {
-	Vector3 aBoxSize = volumeA.GetHalfDimensions();// * 0.5f;
-	Vector3 bBoxSize = volumeB.GetHalfDimensions();// * 0.5f;
-
-	Matrix3 aInvOrientation = Matrix3(worldTransformA.GetOrientation().Conjugate());
-
-	Vector3 bRelativePos = aInvOrientation * (worldTransformB.GetPosition() - worldTransformA.GetPosition());
-
-	Matrix3 relativeOrientation = aInvOrientation * Matrix3(worldTransformB.GetOrientation());
-	Matrix3 absoluteRelative = relativeOrientation.Absolute();
-
-	//Vector3 bBoxExpanded = absoluteRelative * bBoxSize; //need to see how to use this better
-
-	Vector3 realRelativeSize = relativeOrientation * bBoxSize;
-
-	//box a can now be thought of as being axis aligned to b
-
-	bool isParallel = false;
-
-	for (int i = 0; i < 9; ++i) {
-		if (absoluteRelative.array[i] > 0.999f) {
-			isParallel = true;
-			break;
+namespace {
+	/*
+	A face is only given up for another face or an edge if that overlaps by
+	noticeably less. Otherwise, boxes resting flat on each other could flip
+	between features from one substep to the next, as the overlaps along
+	several axes can be all but the same.
+	*/
+	const float relativeTolerance = 0.98f;
+	const float absoluteTolerance = 0.001f;
+
+	//Edges any closer to parallel than this don't make a usable axis
+	const float parallelTolerance = 1e-5f;
+
+	const int faceAxesB		= 3;
+	const int edgeAxes		= 6;
+	const int axisCount		= 15;
+	const int maxClipped	= 8;
+
+	//Sutherland-Hodgman - keeps the part of the polygon where Dot(normal, p) <= offset
+	int ClipPolygon(const Vector3* in, int count, const Vector3& normal, float offset, Vector3* out) {
+		int outCount = 0;
+		for (int i = 0; i < count; ++i) {
+			const Vector3& from = in[i];
+			const Vector3& to	= in[(i + 1) % count];
+			float fromDistance	= Vector3::Dot(normal, from) - offset;
+			float toDistance	= Vector3::Dot(normal, to) - offset;
+
+			if (fromDistance <= 0.0f) {
+				out[outCount++] = from;
+			}
+			if ((fromDistance < 0.0f && toDistance > 0.0f) || (fromDistance > 0.0f && toDistance < 0.0f)) {
+				float t = fromDistance / (fromDistance - toDistance);
+				out[outCount++] = from + (to - from) * t;
+			}
 		}
+		return outCount;
 	}
 
-	float bestOnA = -FLT_MAX;
-	float bestOnB = -FLT_MAX;
-	float bestOnEdge = -FLT_MAX;
+	/*
+	Picks the 4 points that cover the most of the contact area - the deepest,
+	the one furthest from it, and then the two that make the biggest triangles
+	with those, one on either side.
+	*/
+	void ReducePoints(const Vector3* points, const float* depths, int count, const Vector3& normal, int* chosen) {
+		chosen[0] = 0;
+		for (int i = 1; i < count; ++i) {
+			if (depths[i] > depths[chosen[0]]) {
+				chosen[0] = i;
+			}
+		}
+		chosen[1] = chosen[0] == 0 ? 1 : 0;
+		float furthest = -1.0f;
+		for (int i = 0; i < count; ++i) {
+			float distance = (points[i] - points[chosen[0]]).LengthSquared();
+			if (i != chosen[0] && distance > furthest) {
+				furthest	= distance;
+				chosen[1]	= i;
+			}
+		}
+		Vector3 line = points[chosen[1]] - points[chosen[0]];
+		float mostPositive = -FLT_MAX;
+		float mostNegative = FLT_MAX;
+		for (int i = 0; i < count; ++i) {
+			if (i == chosen[0] || i == chosen[1]) {
+				continue;
+			}
+			float area = Vector3::Dot(Vector3::Cross(line, points[i] - points[chosen[0]]), normal);
+			if (area > mostPositive) {
+				mostPositive	= area;
+				chosen[2]		= i;
+			}
+			if (area < mostNegative) {
+				mostNegative	= area;
+				chosen[3]		= i;
+			}
+		}
+		//Points all in a line have nothing either side, so any other point will do
+		if (chosen[3] == chosen[2]) {
+			for (int i = 0; i < count; ++i) {
+				if (i != chosen[0] && i != chosen[1] && i != chosen[2]) {
+					chosen[3] = i;
+					break;
+				}
+			}
+		}
+	}
+}
 
-	int bestAAxis = 0;
-	int bestBAxis = 0;
+SATAlgorithm::Box::Box(const Vector3& position, const Quaternion& orientation, const Vector3& halfSizes) {
+	this->position	= position;
+	this->halfSizes = halfSizes;
+	axes[0] = orientation * Vector3(1, 0, 0);
+	axes[1] = orientation * Vector3(0, 1, 0);
+	axes[2] = orientation * Vector3(0, 0, 1);
+}
 
-	bool noCollide = false;
+/*
+Axes 0 to 2 are A's face normals, 3 to 5 are B's, and the rest are the
+cross products of each of A's edges with each of B's.
+*/
+bool SATAlgorithm::GetAxis(const Box& boxA, const Box& boxB, int index, Vector3& axis) {
+	if (index < faceAxesB) {
+		axis = boxA.axes[index];
+		return true;
+	}
+	if (index < edgeAxes) {
+		axis = boxB.axes[index - faceAxesB];
+		return true;
+	}
+	int edge = index - edgeAxes;
+	axis = Vector3::Cross(boxA.axes[edge / 3], boxB.axes[edge % 3]);
+	float length = axis.Length();
+	if (length < parallelTolerance) {
+		return false;
+	}
+	axis = axis / length;
+	return true;
+}
 
-	//Test A axes
+//How far apart the boxes' shadows are along the axis - negative if they overlap
+float SATAlgorithm::Separation(const Box& boxA, const Box& boxB, const Vector3& axis) {
+	float distance = fabs(Vector3::Dot(boxB.position - boxA.position, axis));
+	float extentA = 0.0f;
+	float extentB = 0.0f;
 	for (int i = 0; i < 3; ++i) {
-		float s = abs(bRelativePos[i]) - (aBoxSize[i] + Vector3::Dot(absoluteRelative.GetRow(i), bBoxSize));
+		extentA += boxA.halfSizes[i] * fabs(Vector3::Dot(boxA.axes[i], axis));
+		extentB += boxB.halfSizes[i] * fabs(Vector3::Dot(boxB.axes[i], axis));
+	}
+	return distance - extentA - extentB;
+}
 
-		if (s > 0.0f) {
-			noCollide = true;
-			//definately not colliding, there's a separation on this axis
-		}
+bool SATAlgorithm::BoundingBoxSAT(const Box& boxA, const Box& boxB, CollisionDetection::CollisionInfo& collisionInfo, int* cachedAxis) {
+	Vector3 axis;
 
-		if (s > bestOnA) {
-			bestOnA = s;
-			bestAAxis = i;
+	//Whatever separated the boxes last time will usually still be separating them
+	if (cachedAxis && *cachedAxis >= 0 && *cachedAxis < axisCount) {
+		if (GetAxis(boxA, boxB, *cachedAxis, axis) && Separation(boxA, boxB, axis) > 0.0f) {
+			return false;
 		}
 	}
 
-	//Now test B Axes
-	for (int i = 0; i < 3; ++i) {
-
-		float s = abs(Vector3::Dot(bRelativePos, relativeOrientation.GetColumn(i))) - (bBoxSize[i] + Vector3::Dot(absoluteRelative.GetColumn(i), aBoxSize));
+	float	best[3]		= { -FLT_MAX, -FLT_MAX, -FLT_MAX };	//A's faces, B's faces, and the edges
+	int		bestAxis[3] = { -1, -1, -1 };
 
+	for (int i = 0; i < axisCount; ++i) {
+		if (!GetAxis(boxA, boxB, i, axis)) {
+			continue;
+		}
+		float s = Separation(boxA, boxB, axis);
 		if (s > 0.0f) {
-			noCollide = true;
-			//definately not colliding, there's a separation on this axis
+			if (cachedAxis) {
+				*cachedAxis = i;
+			}
+			return false;
 		}
-
-		if (s > bestOnB) {
-			bestOnB = s;
-			bestBAxis = i;
+		int group = i < faceAxesB ? 0 : (i < edgeAxes ? 1 : 2);
+		if (s > best[group]) {
+			best[group]		= s;
+			bestAxis[group] = i;
 		}
 	}
 
-	//Now we have to also check the edges
-
-	Vector3 bestEdgeAxis;
-	if (!isParallel) {
-		for (int a = 0; a < 3; ++a) {
-			Vector3 aDir = absoluteRelative.GetColumn(a);
-			for (int b = 0; b < 3; ++b) {
-				Vector3 bDir = relativeOrientation.GetColumn(b);
-
-				Vector3 l = Vector3::Cross(aDir, bDir);
-
-				if (l.Length() == 0.0f) {
-					continue;
-				}
+	int		chosen		= bestAxis[0];
+	float	separation	= best[0];
+	if (best[1] > relativeTolerance * separation + absoluteTolerance) {
+		chosen		= bestAxis[1];
+		separation	= best[1];
+	}
+	if (bestAxis[2] != -1 && best[2] > relativeTolerance * separation + absoluteTolerance) {
+		chosen		= bestAxis[2];
+		separation	= best[2];
+	}
+	if (cachedAxis) {
+		*cachedAxis = chosen;
+	}
 
-				float tl = Vector3::Dot(bRelativePos, l);
-				float al = Vector3::Dot(aBoxSize, l);
-				float bl = Vector3::Dot(realRelativeSize, l);
+	if (chosen < faceAxesB) {
+		FaceContacts(boxA, boxB, chosen, true, collisionInfo);
+	}
+	else if (chosen < edgeAxes) {
+		FaceContacts(boxB, boxA, chosen - faceAxesB, false, collisionInfo);
+	}
+	else {
+		EdgeContact(boxA, boxB, (chosen - edgeAxes) / 3, (chosen - edgeAxes) % 3, separation, collisionInfo);
+	}
+	return collisionInfo.pointCount > 0;
+}
 
-				float s = abs(tl) - (abs(al) + abs(bl));
+/*
+The face of the incident box most opposed to the reference face is clipped
+against the reference face's 4 sides, and whatever is left below the
+reference face becomes the contact points.
+*/
+void SATAlgorithm::FaceContacts(const Box& reference, const Box& incident, int face, bool referenceIsA, CollisionDetection::CollisionInfo& collisionInfo) {
+	Vector3 normal = reference.axes[face];
+	if (Vector3::Dot(normal, incident.position - reference.position) < 0.0f) {
+		normal = -normal;
+	}
 
-				if (s > 0.0f) {
-					noCollide = true;//definately not colliding, there's a separation on this axis
-				}
-				if (s > bestOnEdge) {
-					bestOnEdge = s;
-					//bestAAxis	= a;
-					//bestBAxis	= b;
-					bestEdgeAxis = l;
-				}
+	int		incidentFace	= 0;
+	float	mostAligned		= 0.0f;
+	for (int i = 0; i < 3; ++i) {
+		float d = Vector3::Dot(incident.axes[i], normal);
+		if (fabs(d) > fabs(mostAligned)) {
+			mostAligned		= d;
+			incidentFace	= i;
+		}
+	}
+	Vector3 incidentNormal	= mostAligned > 0.0f ? -incident.axes[incidentFace] : incident.axes[incidentFace];
+	Vector3 centre			= incident.position + incidentNormal * incident.halfSizes[incidentFace];
+	int		u = (incidentFace + 1) % 3;
+	int		v = (incidentFace + 2) % 3;
+	Vector3 du = incident.axes[u] * incident.halfSizes[u];
+	Vector3 dv = incident.axes[v] * incident.halfSizes[v];
+
+	Vector3 polygon[maxClipped] = { centre + du + dv, centre - du + dv, centre - du - dv, centre + du - dv };
+	Vector3 clipped[maxClipped];
+	int		count = 4;
+
+	for (int side = 1; side < 3; ++side) {
+		int sideAxis = (face + side) % 3;
+		for (float sign = -1.0f; sign <= 1.0f; sign += 2.0f) {
+			Vector3 sideNormal	= reference.axes[sideAxis] * sign;
+			float	offset		= Vector3::Dot(sideNormal, reference.position) + reference.halfSizes[sideAxis];
+			count = ClipPolygon(polygon, count, sideNormal, offset, clipped);
+			if (count == 0) {
+				return;
+			}
+			for (int i = 0; i < count; ++i) {
+				polygon[i] = clipped[i];
 			}
 		}
 	}
 
-	Vector3 aNorm = Vector3(worldTransformA.GetMatrix().GetColumn(bestAAxis));
-	Vector3 otherA = aInvOrientation.GetColumn(bestAAxis);
-
-	Vector3 bNorm = Vector3(worldTransformB.GetMatrix().GetColumn(bestBAxis));
-	Vector3 edgeNorm = bestEdgeAxis;
-
-	Debug::DrawLine(worldTransformA.GetPosition(), worldTransformA.GetPosition() + (aNorm  * bestOnA * 0.5f), Vector4(1, 0, 0, 1));
-	Debug::DrawLine(worldTransformA.GetPosition(), worldTransformA.GetPosition() + (otherA  * bestOnA * 0.5f), Vector4(0.5, 0, 0, 1));
-
-	Debug::DrawLine(worldTransformB.GetPosition(), worldTransformB.GetPosition() + (bNorm  * bestOnB * 0.5f), Vector4(1, 1, 0, 1));
-
-
-	//float bestFace = max(bestOnA, bestOnB);
-
-	//if (bestOnEdge > bestFace) {
-	//	Vector3 norm = bestEdgeAxis;
-	//	Debug::DrawLine(worldTransformA.GetWorldPosition(), worldTransformA.GetWorldPosition() + (norm  * 15.0f), Vector4(1, 0, 0, 1));
-	//}
-	//else {
-	//	if (bestOnA > bestOnB) {
-	//		Vector3 norm = worldTransformA.GetWorldMatrix().GetColumn(bestAAxis).ToVector3();
-	//		Debug::DrawLine(worldTransformA.GetWorldPosition(), worldTransformA.GetWorldPosition() + (norm  * 15.0f), Vector4(1, 0, 0, 1));
-	//	}
-	//	else {
-	//		Vector3 bNorm = worldTransformB.GetWorldMatrix().GetColumn(bestBAxis).ToVector3();
-	//		Debug::DrawLine(worldTransformB.GetWorldPosition(), worldTransformB.GetWorldPosition() + (bNorm  * 15.0f), Vector4(1, 0, 0, 1));
-	//	}
-	//}
-
-	////Vector3 aNorm = worldTransformA.GetWorldMatrix().GetColumn(bestAAxis).ToVector3();
-	////
-	////Vector3 edgeNorm = bestEdgeAxis;
-
-	////Vector3 lolTest = Vector3::Cross(aNorm, bNorm);
-	//Vector3 bNorm = worldTransformB.GetWorldMatrix().GetColumn(bestBAxis).ToVector3();
-	////Debug::DrawLine(worldTransformA.GetWorldPosition(), worldTransformA.GetWorldPosition() + (aNorm  * 15.0f), Vector4(1, 0, 0, 1));
-	//Debug::DrawLine(worldTransformB.GetWorldPosition(), worldTransformB.GetWorldPosition() + (bNorm  * 15.0f), Vector4(1, 1, 0, 1));
-
-	////Debug::DrawLine(worldTransformA.GetWorldPosition(), worldTransformA.GetWorldPosition() + (lolTest  * 15.0f), Vector4(0.2, 0.1, 0.8, 1));
-
-	//////Debug::DrawLine(worldTransformA.GetWorldPosition(), worldTransformA.GetWorldPosition() + (edgeNorm  * 15.0f), Vector4(0, 1, 1, 1));
-
-
-	if (noCollide) {
-		return false;
+	float	faceOffset = Vector3::Dot(normal, reference.position) + reference.halfSizes[face];
+	Vector3 points[maxClipped];
+	float	depths[maxClipped];
+	int		found = 0;
+	for (int i = 0; i < count; ++i) {
+		float depth = faceOffset - Vector3::Dot(normal, polygon[i]);
+		if (depth >= 0.0f) {
+			points[found] = polygon[i];
+			depths[found] = depth;
+			++found;
+		}
 	}
 
-	float bestFace = max(bestOnA, bestOnB);
-
-	//if (noCollide) {
-	//	std::cout << "SAT NO COLLIDE?" << std::endl;
-	//}
-
-	if (bestOnEdge > bestFace) {
-		std::cout << "SAT EDGE COLLISION " << bestOnEdge << std::endl;
+	int chosen[CollisionDetection::MAX_CONTACT_POINTS];
+	int chosenCount = found;
+	if (found > CollisionDetection::MAX_CONTACT_POINTS) {
+		ReducePoints(points, depths, found, normal, chosen);
+		chosenCount = CollisionDetection::MAX_CONTACT_POINTS;
 	}
 	else {
-		std::cout << "SAT FACE COLLISION " << bestFace << std::endl;
+		for (int i = 0; i < found; ++i) {
+			chosen[i] = i;
+		}
+	}
+
+	for (int i = 0; i < chosenCount; ++i) {
+		const Vector3&	onIncident	= points[chosen[i]];
+		float			depth		= depths[chosen[i]];
+		Vector3			onReference = onIncident + normal * depth;
+
+		if (referenceIsA) {
+			collisionInfo.AddContactPoint(onReference - reference.position, onIncident - incident.position, normal, depth);
+		}
+		else {
+			collisionInfo.AddContactPoint(onIncident - incident.position, onReference - reference.position, -normal, depth);
+		}
 	}
-	return true;
 }
 
-void SATAlgorithm::OBBSupport(Vector3& min, Vector3& max, const Vector3& objectPos, const Vector3& axis) {
-	Vector3 tangents[2];
+/*
+The edges touching are the ones furthest along the axis on A, and furthest
+back along it on B. The contact is between the closest points of the two.
+*/
+void SATAlgorithm::EdgeContact(const Box& boxA, const Box& boxB, int edgeA, int edgeB, float separation, CollisionDetection::CollisionInfo& collisionInfo) {
+	Vector3 normal = Vector3::Cross(boxA.axes[edgeA], boxB.axes[edgeB]).Normalised();
+	if (Vector3::Dot(normal, boxB.position - boxA.position) < 0.0f) {
+		normal = -normal;
+	}
 
-	//tangents[0] = 
+	Vector3 pointA = boxA.position;
+	Vector3 pointB = boxB.position;
+	for (int i = 0; i < 3; ++i) {
+		if (i != edgeA) {
+			float sign = Vector3::Dot(boxA.axes[i], normal) > 0.0f ? 1.0f : -1.0f;
+			pointA = pointA + boxA.axes[i] * (boxA.halfSizes[i] * sign);
+		}
+		if (i != edgeB) {
+			float sign = Vector3::Dot(boxB.axes[i], normal) < 0.0f ? 1.0f : -1.0f;
+			pointB = pointB + boxB.axes[i] * (boxB.halfSizes[i] * sign);
+		}
+	}
 
-}
\ No newline at end of file
+	//Closest points between the two edges, each kept within its own length
+	const Vector3& directionA = boxA.axes[edgeA];
+	const Vector3& directionB = boxB.axes[edgeB];
+	Vector3 r = pointA - pointB;
+	float	b = Vector3::Dot(directionA, directionB);
+	float	c = Vector3::Dot(directionA, r);
+	float	f = Vector3::Dot(directionB, r);
+	float	denominator = 1.0f - b * b;
+
+	float	halfA = boxA.halfSizes[edgeA];
+	float	halfB = boxB.halfSizes[edgeB];
+	float	s = denominator > 0.0f ? (b * f - c) / denominator : 0.0f;
+	s = s < -halfA ? -halfA : (s > halfA ? halfA : s);
+	float	t = b * s + f;
+	t = t < -halfB ? -halfB : (t > halfB ? halfB : t);
+	s = b * t - c;
+	s = s < -halfA ? -halfA : (s > halfA ? halfA : s);
+
+	Vector3 contactA = pointA + directionA * s;
+	Vector3 contactB = pointB + directionB * t;
+	collisionInfo.AddContactPoint(contactA - boxA.position, contactB - boxB.position, normal, -separation);
+}
@@ -0,0 +1,48 @@
+#pragma once
+#include "CollisionDetection.h"
+
+namespace NCL {
+	namespace CSC8503 {
+		/*
+		Box against box collision, using the separating axis theorem. Two boxes
+		only overlap if their shadows overlap along each of the 15 axes that
+		could separate them - the 3 face normals of each box, and the 9 cross
+		products of their edges. The axis they overlap least along tells us
+		which features are touching.
+
+		For a face, the face of the other box most opposed to it is clipped
+		against its sides, giving up to 4 contact points, so boxes resting on
+		each other don't rock from one point to another. Edges only ever touch
+		at a single point.
+		*/
+		class SATAlgorithm	{
+		public:
+			//An AABB is just a box with no orientation
+			struct Box {
+				Vector3 position;
+				Vector3 axes[3];
+				Vector3 halfSizes;
+
+				Box(const Vector3& position, const Quaternion& orientation, const Vector3& halfSizes);
+			};
+
+			/*
+			The axis that separated the boxes, or that they overlapped least along,
+			is put into cachedAxis. If it's given again next time, it's tried first,
+			as boxes that were apart usually still are, along the same axis.
+			*/
+			static bool BoundingBoxSAT(const Box& boxA, const Box& boxB, CollisionDetection::CollisionInfo& collisionInfo, int* cachedAxis = nullptr);
+
+		protected:
+			static bool GetAxis(const Box& boxA, const Box& boxB, int index, Vector3& axis);
+			static float Separation(const Box& boxA, const Box& boxB, const Vector3& axis);
+
+			static void FaceContacts(const Box& reference, const Box& incident, int face, bool referenceIsA, CollisionDetection::CollisionInfo& collisionInfo);
+			static void EdgeContact(const Box& boxA, const Box& boxB, int edgeA, int edgeB, float separation, CollisionDetection::CollisionInfo& collisionInfo);
+
+		private:
+			SATAlgorithm()	{}
+			~SATAlgorithm()	{}
+		};
+	}
+}
@@ -0,0 +1,93 @@
+#pragma once
+#include <cmath>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define NCL_SIMD_AVX
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define NCL_SIMD_SSE
+#endif
+
+/*
+The physics kernels are written once, against this handful of operations,
+so that they can be built as 8 wide AVX, 4 wide SSE, or plain floats for
+any platform that has neither. Comparisons give a mask, which can only be
+used with Select, And, and Mask.
+*/
+namespace NCL {
+	namespace CSC8503 {
+		namespace Simd {
+#if defined(NCL_SIMD_AVX)
+			typedef __m256 SimdFloat;
+			const int SimdWidth = 8;
+
+			inline SimdFloat Load(const float* p)				{ return _mm256_load_ps(p); }
+			inline SimdFloat LoadUnaligned(const float* p)		{ return _mm256_loadu_ps(p); }
+			inline void		 Store(float* p, SimdFloat a)		{ _mm256_store_ps(p, a); }
+			inline SimdFloat Splat(float a)						{ return _mm256_set1_ps(a); }
+			inline SimdFloat Add(SimdFloat a, SimdFloat b)		{ return _mm256_add_ps(a, b); }
+			inline SimdFloat Sub(SimdFloat a, SimdFloat b)		{ return _mm256_sub_ps(a, b); }
+			inline SimdFloat Mul(SimdFloat a, SimdFloat b)		{ return _mm256_mul_ps(a, b); }
+			inline SimdFloat Div(SimdFloat a, SimdFloat b)		{ return _mm256_div_ps(a, b); }
+			inline SimdFloat Sqrt(SimdFloat a)					{ return _mm256_sqrt_ps(a); }
+			inline SimdFloat Min(SimdFloat a, SimdFloat b)		{ return _mm256_min_ps(a, b); }
+			inline SimdFloat Max(SimdFloat a, SimdFloat b)		{ return _mm256_max_ps(a, b); }
+			inline SimdFloat Abs(SimdFloat a)					{ return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a); }
+			inline SimdFloat Greater(SimdFloat a, SimdFloat b)	{ return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+			inline SimdFloat Less(SimdFloat a, SimdFloat b)		{ return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+			inline SimdFloat And(SimdFloat a, SimdFloat b)		{ return _mm256_and_ps(a, b); }
+			inline SimdFloat Select(SimdFloat mask, SimdFloat a, SimdFloat b) { return _mm256_blendv_ps(b, a, mask); }
+			inline int		 Mask(SimdFloat mask)				{ return _mm256_movemask_ps(mask); }
+#elif defined(NCL_SIMD_SSE)
+			typedef __m128 SimdFloat;
+			const int SimdWidth = 4;
+
+			inline SimdFloat Load(const float* p)				{ return _mm_load_ps(p); }
+			inline SimdFloat LoadUnaligned(const float* p)		{ return _mm_loadu_ps(p); }
+			inline void		 Store(float* p, SimdFloat a)		{ _mm_store_ps(p, a); }
+			inline SimdFloat Splat(float a)						{ return _mm_set1_ps(a); }
+			inline SimdFloat Add(SimdFloat a, SimdFloat b)		{ return _mm_add_ps(a, b); }
+			inline SimdFloat Sub(SimdFloat a, SimdFloat b)		{ return _mm_sub_ps(a, b); }
+			inline SimdFloat Mul(SimdFloat a, SimdFloat b)		{ return _mm_mul_ps(a, b); }
+			inline SimdFloat Div(SimdFloat a, SimdFloat b)		{ return _mm_div_ps(a, b); }
+			inline SimdFloat Sqrt(SimdFloat a)					{ return _mm_sqrt_ps(a); }
+			inline SimdFloat Min(SimdFloat a, SimdFloat b)		{ return _mm_min_ps(a, b); }
+			inline SimdFloat Max(SimdFloat a, SimdFloat b)		{ return _mm_max_ps(a, b); }
+			inline SimdFloat Abs(SimdFloat a)					{ return _mm_andnot_ps(_mm_set1_ps(-0.0f), a); }
+			inline SimdFloat Greater(SimdFloat a, SimdFloat b)	{ return _mm_cmpgt_ps(a, b); }
+			inline SimdFloat Less(SimdFloat a, SimdFloat b)		{ return _mm_cmplt_ps(a, b); }
+			inline SimdFloat And(SimdFloat a, SimdFloat b)		{ return _mm_and_ps(a, b); }
+			inline SimdFloat Select(SimdFloat mask, SimdFloat a, SimdFloat b) {
+				return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+			}
+			inline int		 Mask(SimdFloat mask)				{ return _mm_movemask_ps(mask); }
+#else
+			typedef float SimdFloat;
+			const int SimdWidth = 1;
+
+			inline SimdFloat Load(const float* p)				{ return *p; }
+			inline SimdFloat LoadUnaligned(const float* p)		{ return *p; }
+			inline void		 Store(float* p, SimdFloat a)		{ *p = a; }
+			inline SimdFloat Splat(float a)						{ return a; }
+			inline SimdFloat Add(SimdFloat a, SimdFloat b)		{ return a + b; }
+			inline SimdFloat Sub(SimdFloat a, SimdFloat b)		{ return a - b; }
+			inline SimdFloat Mul(SimdFloat a, SimdFloat b)		{ return a * b; }
+			inline SimdFloat Div(SimdFloat a, SimdFloat b)		{ return a / b; }
+			inline SimdFloat Sqrt(SimdFloat a)					{ return sqrtf(a); }
+			inline SimdFloat Min(SimdFloat a, SimdFloat b)		{ return a < b ? a : b; }
+			inline SimdFloat Max(SimdFloat a, SimdFloat b)		{ return a > b ? a : b; }
+			inline SimdFloat Abs(SimdFloat a)					{ return fabsf(a); }
+			inline SimdFloat Greater(SimdFloat a, SimdFloat b)	{ return a > b ? 1.0f : 0.0f; }
+			inline SimdFloat Less(SimdFloat a, SimdFloat b)		{ return a < b ? 1.0f : 0.0f; }
+			inline SimdFloat And(SimdFloat a, SimdFloat b)		{ return a != 0.0f && b != 0.0f ? 1.0f : 0.0f; }
+			inline SimdFloat Select(SimdFloat mask, SimdFloat a, SimdFloat b) { return mask != 0.0f ? a : b; }
+			inline int		 Mask(SimdFloat mask)				{ return mask != 0.0f ? 1 : 0; }
+#endif
+
+			struct SimdVector3 {
+				SimdFloat x, y, z;
+			};
+		}
+	}
+}
@@ -8,6 +8,7 @@ using namespace CSC8503;
 
 StateGameObject::StateGameObject() {
 	counter = 0.0f;
+	speed	= 10.0f;
 	testStateObject = nullptr;
 	stateMachine = new StateMachine();
 
@@ -47,12 +48,13 @@ void StateGameObject::Update(float dt) {
 	stateMachine->Update(dt);
 }
 
+//The object should be kinematic, so that it sticks to its path whatever it bumps into
 void StateGameObject::MoveLeft(float dt) {
-	GetPhysicsObject()->AddForce({ -100.0f, 0.0f, 0.0f });
+	GetPhysicsObject()->SetLinearVelocity({ -speed, 0.0f, 0.0f });
 	counter += dt;
 }
 
 void StateGameObject::MoveRight(float dt) {
-	GetPhysicsObject()->AddForce({ 100.0f, 0.0f, 0.0f });
+	GetPhysicsObject()->SetLinearVelocity({ speed, 0.0f, 0.0f });
 	counter -= dt;
 }
\ No newline at end of file
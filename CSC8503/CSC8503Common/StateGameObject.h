@@ -20,6 +20,7 @@ namespace NCL {
 
 			StateMachine* stateMachine;
 			float counter;
+			float speed;
 		};
 	}
 }
@@ -0,0 +1,291 @@
+#include "SweepAndPruneBroadPhase.h"
+#include "GameObject.h"
+#include <cfloat>
+#include <algorithm>
+
+using namespace NCL;
+using namespace CSC8503;
+
+SweepAndPruneBroadPhase::SweepAndPruneBroadPhase() {
+}
+
+SweepAndPruneBroadPhase::~SweepAndPruneBroadPhase() {
+}
+
+/*
+Any pairs already passed out through FindPairs are forgotten about here, so
+the buffer they were added to must be cleared along with the broadphase.
+*/
+void SweepAndPruneBroadPhase::ClearProxies() {
+	proxyPool.clear();
+	freeProxies.clear();
+	removedProxies.clear();
+	addedProxies.clear();
+	pairMap.clear();
+	changedPairs.clear();
+	bufferKeys.clear();
+	for (int i = 0; i < 3; ++i) {
+		endpoints[i].clear();
+	}
+}
+
+/*
+New proxies aren't sorted into the axes straight away, as sorting them in one
+at a time is quadratic when a lot of objects are added at once, like when a
+level is first loaded. Instead they are all added in one go in FindPairs.
+*/
+int SweepAndPruneBroadPhase::AddProxy(GameObject* object, const Vector3& position, const Vector3& halfSize) {
+	int index;
+	if (!freeProxies.empty()) {
+		index = freeProxies.back();
+		freeProxies.pop_back();
+	}
+	else {
+		index = (int)proxyPool.size();
+		proxyPool.emplace_back();
+	}
+	Proxy& p	= proxyPool[index];
+	p.object	= object;
+	p.box		= BoundingBox(position, halfSize);
+	p.pending	= true;
+
+	addedProxies.emplace_back(index);
+	return index;
+}
+
+/*
+Appends the endpoints of every newly added proxy, and sorts each axis in full.
+A single sweep along the x axis then finds everything that the new proxies
+overlap - while sweeping, every proxy whose min endpoint has been passed, but
+not its max endpoint, overlaps the current one on that axis.
+*/
+void SweepAndPruneBroadPhase::InsertAddedProxies() {
+	if (addedProxies.empty()) {
+		return;
+	}
+	for (int axis = 0; axis < 3; ++axis) {
+		std::vector<Endpoint>& list = endpoints[axis];
+		for (int i : addedProxies) {
+			list.push_back({ proxyPool[i].box.min[axis], i, false });
+			list.push_back({ proxyPool[i].box.max[axis], i, true });
+		}
+		std::sort(list.begin(), list.end());
+		for (int i = 0; i < (int)list.size(); ++i) {
+			SetEndpointIndex(axis, i);
+		}
+	}
+	activeScratch.clear();
+	for (const Endpoint& e : endpoints[0]) {
+		const BoundingBox& box = proxyPool[e.proxy].box;
+		if (box.min.x >= box.max.x) {
+			continue; //flat on this axis, so it can't overlap anything
+		}
+		if (e.isMax) {
+			auto found = std::find(activeScratch.begin(), activeScratch.end(), e.proxy);
+			*found = activeScratch.back();
+			activeScratch.pop_back();
+			continue;
+		}
+		for (int other : activeScratch) {
+			if (proxyPool[e.proxy].pending || proxyPool[other].pending) {
+				StartPair(e.proxy, other);
+			}
+		}
+		activeScratch.emplace_back(e.proxy);
+	}
+
+	for (int i : addedProxies) {
+		proxyPool[i].pending = false;
+	}
+	addedProxies.clear();
+}
+
+void SweepAndPruneBroadPhase::MoveProxy(int handle, const Vector3& position, const Vector3& halfSize) {
+	if (proxyPool[handle].pending) {
+		proxyPool[handle].box = BoundingBox(position, halfSize);
+		return;
+	}
+	SetBounds(handle, BoundingBox(position, halfSize));
+}
+
+/*
+The opposite of adding - the proxy is moved past the end of every axis,
+which stops any pairs it was in, and then its endpoints are popped off.
+The proxy can't be reused until its stopped pairs have been dealt with,
+otherwise a new proxy could pick up one of its pairs.
+*/
+void SweepAndPruneBroadPhase::RemoveProxy(int handle) {
+	InsertAddedProxies();
+
+	BoundingBox farAway;
+	farAway.min = Vector3(FLT_MAX, FLT_MAX, FLT_MAX);
+	farAway.max = Vector3(FLT_MAX, FLT_MAX, FLT_MAX);
+	SetBounds(handle, farAway);
+
+	for (int axis = 0; axis < 3; ++axis) {
+		endpoints[axis].pop_back();
+		endpoints[axis].pop_back();
+	}
+	proxyPool[handle].object = nullptr;
+	removedProxies.emplace_back(handle);
+}
+
+/*
+Growing moves are done before shrinking ones, so that a proxy's min endpoint
+never has to pass its own max endpoint on the way to its new position.
+*/
+void SweepAndPruneBroadPhase::SetBounds(int handle, const BoundingBox& box) {
+	Proxy& p = proxyPool[handle];
+	BoundingBox oldBox = p.box;
+	p.box = box;
+
+	for (int axis = 0; axis < 3; ++axis) {
+		endpoints[axis][p.minIndex[axis]].value = box.min[axis];
+		endpoints[axis][p.maxIndex[axis]].value = box.max[axis];
+
+		if (box.min[axis] < oldBox.min[axis]) {
+			SortDown(axis, p.minIndex[axis]);
+		}
+		if (box.max[axis] > oldBox.max[axis]) {
+			SortUp(axis, p.maxIndex[axis]);
+		}
+		if (box.min[axis] > oldBox.min[axis]) {
+			SortUp(axis, p.minIndex[axis]);
+		}
+		if (box.max[axis] < oldBox.max[axis]) {
+			SortDown(axis, p.maxIndex[axis]);
+		}
+	}
+}
+
+void SweepAndPruneBroadPhase::SetEndpointIndex(int axis, int index) {
+	const Endpoint& e = endpoints[axis][index];
+	if (e.isMax) {
+		proxyPool[e.proxy].maxIndex[axis] = index;
+	}
+	else {
+		proxyPool[e.proxy].minIndex[axis] = index;
+	}
+}
+
+/*
+Moving a min endpoint down past another proxy's max endpoint means the two
+might now overlap, while moving a max endpoint down past a min endpoint means
+they definitely don't.
+*/
+void SweepAndPruneBroadPhase::SortDown(int axis, int index) {
+	std::vector<Endpoint>& list = endpoints[axis];
+	while (index > 0 && list[index] < list[index - 1]) {
+		Endpoint& e		= list[index];
+		Endpoint& prev	= list[index - 1];
+
+		if (e.proxy != prev.proxy) {
+			if (!e.isMax && prev.isMax) {
+				StartPair(e.proxy, prev.proxy);
+			}
+			else if (e.isMax && !prev.isMax) {
+				StopPair(e.proxy, prev.proxy);
+			}
+		}
+		std::swap(e, prev);
+		SetEndpointIndex(axis, index);
+		SetEndpointIndex(axis, index - 1);
+		index--;
+	}
+}
+
+void SweepAndPruneBroadPhase::SortUp(int axis, int index) {
+	std::vector<Endpoint>& list = endpoints[axis];
+	int last = (int)list.size() - 1;
+	while (index < last && list[index + 1] < list[index]) {
+		Endpoint& e		= list[index];
+		Endpoint& next	= list[index + 1];
+
+		if (e.proxy != next.proxy) {
+			if (e.isMax && !next.isMax) {
+				StartPair(e.proxy, next.proxy);
+			}
+			else if (!e.isMax && next.isMax) {
+				StopPair(e.proxy, next.proxy);
+			}
+		}
+		std::swap(e, next);
+		SetEndpointIndex(axis, index);
+		SetEndpointIndex(axis, index + 1);
+		index++;
+	}
+}
+
+//Passing an endpoint on one axis only matters if the boxes overlap on the other two
+void SweepAndPruneBroadPhase::StartPair(int a, int b) {
+	if (!proxyPool[a].box.Overlaps(proxyPool[b].box) || !CanCollide(proxyPool[a].object, proxyPool[b].object)) {
+		return;
+	}
+	uint64_t key = ProxyPairKey(a, b);
+	auto found = pairMap.find(key);
+	if (found == pairMap.end()) {
+		Pair pair;
+		pair.a				= proxyPool[a].object;
+		pair.b				= proxyPool[b].object;
+		pair.overlapping	= false;
+		pair.changed		= false;
+		pair.bufferIndex	= -1;
+		found = pairMap.insert({ key, pair }).first;
+	}
+	Pair& pair = found->second;
+	pair.overlapping = true;
+	if (!pair.changed) {
+		pair.changed = true;
+		changedPairs.emplace_back(key);
+	}
+}
+
+void SweepAndPruneBroadPhase::StopPair(int a, int b) {
+	auto found = pairMap.find(ProxyPairKey(a, b));
+	if (found == pairMap.end()) {
+		return;
+	}
+	Pair& pair = found->second;
+	pair.overlapping = false;
+	if (!pair.changed) {
+		pair.changed = true;
+		changedPairs.emplace_back(found->first);
+	}
+}
+
+/*
+Only the pairs that started or stopped since the last update are touched.
+Stopped pairs are swapped out of the buffer by index, so their objects are
+never looked at - they might have been deleted since the pair was added.
+*/
+void SweepAndPruneBroadPhase::FindPairs(PairBuffer& pairs) {
+	InsertAddedProxies();
+
+	for (uint64_t key : changedPairs) {
+		auto found = pairMap.find(key);
+		Pair& pair = found->second;
+		pair.changed = false;
+
+		if (pair.overlapping) {
+			if (pair.bufferIndex == -1) {
+				pair.bufferIndex = pairs.Add(pair.a, pair.b);
+				bufferKeys.emplace_back(key);
+			}
+			continue;
+		}
+		int index = pair.bufferIndex;
+		if (index != -1) {
+			pairs.RemoveAt(index);
+			bufferKeys[index] = bufferKeys.back();
+			bufferKeys.pop_back();
+			if (index < (int)bufferKeys.size()) {
+				pairMap[bufferKeys[index]].bufferIndex = index;
+			}
+		}
+		pairMap.erase(found);
+	}
+	changedPairs.clear();
+
+	freeProxies.insert(freeProxies.end(), removedProxies.begin(), removedProxies.end());
+	removedProxies.clear();
+}
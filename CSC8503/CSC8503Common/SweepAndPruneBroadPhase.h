@@ -0,0 +1,98 @@
+#pragma once
+#include "BroadPhaseStructure.h"
+#include "AABBTree.h"
+#include <vector>
+#include <unordered_map>
+
+namespace NCL {
+	namespace CSC8503 {
+		/*
+		A 3 axis sort and sweep broadphase. Each axis keeps a list of the min
+		and max endpoints of every proxy, which is kept sorted with an insertion
+		sort. As most objects barely move between substeps, the lists are nearly
+		sorted already, and updating them is close to linear.
+
+		Pairs are started and stopped as endpoints swap past each other, so
+		rather than rebuilding the list of pairs every update, the buffer passed
+		to FindPairs is only modified by the pairs that changed. This means the
+		same buffer must be passed in every time, and must not be cleared or
+		sorted by anything else without also clearing the broadphase.
+		*/
+		class SweepAndPruneBroadPhase : public BroadPhaseStructure	{
+		public:
+			SweepAndPruneBroadPhase();
+			~SweepAndPruneBroadPhase();
+
+			bool IsIncremental() const override {
+				return true;
+			}
+
+			void FindPairs(PairBuffer& pairs) override;
+
+			int GetPairCount() const {
+				return (int)pairMap.size();
+			}
+
+		protected:
+			struct Endpoint {
+				float	value;
+				int		proxy;
+				bool	isMax;
+
+				//At equal values, max endpoints sort first, so touching boxes don't overlap
+				bool operator < (const Endpoint& other) const {
+					if (value != other.value) {
+						return value < other.value;
+					}
+					return isMax && !other.isMax;
+				}
+			};
+
+			struct Proxy {
+				GameObject* object;
+				BoundingBox box;
+				int			minIndex[3];
+				int			maxIndex[3];
+				bool		pending; //added, but not sorted into the axes yet
+			};
+
+			struct Pair {
+				GameObject* a;
+				GameObject* b;
+				bool		overlapping;
+				bool		changed;
+				int			bufferIndex; //-1 if not in the pair buffer
+			};
+
+			void	ClearProxies() override;
+			int		AddProxy(GameObject* object, const Vector3& position, const Vector3& halfSize) override;
+			void	MoveProxy(int handle, const Vector3& position, const Vector3& halfSize) override;
+			void	RemoveProxy(int handle) override;
+
+			void	SetBounds(int handle, const BoundingBox& box);
+			void	InsertAddedProxies();
+
+			void	SortDown(int axis, int index);
+			void	SortUp(int axis, int index);
+			void	SetEndpointIndex(int axis, int index);
+
+			void	StartPair(int a, int b);
+			void	StopPair(int a, int b);
+
+			static uint64_t ProxyPairKey(int a, int b) {
+				return a < b ? ((uint64_t)a << 32) | (uint32_t)b : ((uint64_t)b << 32) | (uint32_t)a;
+			}
+
+			std::vector<Endpoint>	endpoints[3];
+			std::vector<Proxy>		proxyPool;
+			std::vector<int>		freeProxies;
+			std::vector<int>		removedProxies;
+			std::vector<int>		addedProxies;
+			std::vector<int>		activeScratch;
+
+			std::unordered_map<uint64_t, Pair>	pairMap;
+			std::vector<uint64_t>				changedPairs;
+			std::vector<uint64_t>				bufferKeys; //the pair at each index of the pair buffer
+		};
+	}
+}
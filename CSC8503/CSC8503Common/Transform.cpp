@@ -4,7 +4,8 @@ using namespace NCL::CSC8503;
 
 Transform::Transform()
 {
-	scale	= Vector3(1, 1, 1);
+	scale		= Vector3(1, 1, 1);
+	matrixDirty = true;
 }
 
 Transform::~Transform()
@@ -12,28 +13,29 @@ Transform::~Transform()
 
 }
 
-void Transform::UpdateMatrix() {
+void Transform::UpdateMatrix() const {
 	matrix =
 		Matrix4::Translation(position) *
 		Matrix4(orientation) *
 		Matrix4::Scale(scale);
+	matrixDirty = false;
 }
 
 Transform& Transform::SetPosition(const Vector3& worldPos) {
 	position = worldPos;
-	UpdateMatrix();
+	matrixDirty = true;
 	return *this;
 }
 
 Transform& Transform::SetScale(const Vector3& worldScale) {
 	scale = worldScale;
-	UpdateMatrix();
+	matrixDirty = true;
 	return *this;
 }
 
 Transform& Transform::SetOrientation(const Quaternion& worldOrientation) {
 	orientation = worldOrientation;
-	UpdateMatrix();
+	matrixDirty = true;
 	return *this;
 }
 
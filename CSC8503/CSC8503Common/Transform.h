@@ -39,12 +39,23 @@ namespace NCL {
 				return orientation;
 			}
 
+			//Built on demand, if anything has changed since it was last asked for
 			Matrix4 GetMatrix() const {
+				if (matrixDirty) {
+					UpdateMatrix();
+				}
 				return matrix;
 			}
-			void UpdateMatrix();
+
+			bool IsMatrixDirty() const {
+				return matrixDirty;
+			}
+
+			//Physics moves objects several times a frame, so the matrix is only rebuilt when it's needed
+			void UpdateMatrix() const;
 		protected:
-			Matrix4		matrix;
+			mutable Matrix4	matrix;
+			mutable bool	matrixDirty;
 			Quaternion	orientation;
 			Vector3		position;
 			Vector3		normal;
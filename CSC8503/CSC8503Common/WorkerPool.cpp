@@ -0,0 +1,92 @@
+#include "WorkerPool.h"
+
+using namespace NCL;
+using namespace CSC8503;
+
+WorkerPool::WorkerPool(int threadCount) {
+	jobFunc			= nullptr;
+	jobCount		= 0;
+	jobBlockSize	= 1;
+	jobGeneration	= 0;
+	busyWorkers		= 0;
+	shuttingDown	= false;
+	nextBlock		= 0;
+
+	for (int i = 1; i < threadCount; ++i) {
+		workers.emplace_back(&WorkerPool::WorkerLoop, this, i);
+	}
+}
+
+WorkerPool::~WorkerPool() {
+	{
+		std::lock_guard<std::mutex> lock(jobMutex);
+		shuttingDown = true;
+	}
+	jobStart.notify_all();
+	for (std::thread& t : workers) {
+		t.join();
+	}
+}
+
+void WorkerPool::ParallelFor(int count, int blockSize, const RangeFunc& func) {
+	if (count <= 0) {
+		return;
+	}
+	blockSize = blockSize < 1 ? 1 : blockSize;
+
+	//Not worth waking anyone up for a single block
+	if (workers.empty() || count <= blockSize) {
+		func(0, count, 0);
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(jobMutex);
+		jobFunc			= &func;
+		jobCount		= count;
+		jobBlockSize	= blockSize;
+		nextBlock		= 0;
+		busyWorkers		= (int)workers.size();
+		jobGeneration++;
+	}
+	jobStart.notify_all();
+
+	RunBlocks(0);
+
+	std::unique_lock<std::mutex> lock(jobMutex);
+	jobDone.wait(lock, [&] { return busyWorkers == 0; });
+	jobFunc = nullptr;
+}
+
+void WorkerPool::RunBlocks(int thread) {
+	while (true) {
+		int begin = nextBlock.fetch_add(jobBlockSize);
+		if (begin >= jobCount) {
+			return;
+		}
+		int end = begin + jobBlockSize < jobCount ? begin + jobBlockSize : jobCount;
+		(*jobFunc)(begin, end, thread);
+	}
+}
+
+void WorkerPool::WorkerLoop(int thread) {
+	int seenGeneration = 0;
+	while (true) {
+		{
+			std::unique_lock<std::mutex> lock(jobMutex);
+			jobStart.wait(lock, [&] { return shuttingDown || jobGeneration != seenGeneration; });
+			if (shuttingDown) {
+				return;
+			}
+			seenGeneration = jobGeneration;
+		}
+
+		RunBlocks(thread);
+
+		{
+			std::lock_guard<std::mutex> lock(jobMutex);
+			busyWorkers--;
+		}
+		jobDone.notify_one();
+	}
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+
+namespace NCL {
+	namespace CSC8503 {
+		/*
+		A fixed set of worker threads that physics work can be split across.
+		The thread calling ParallelFor works too, so a pool of 1 thread runs
+		everything on the caller, with no threads created at all.
+
+		Work is handed out in small blocks of indices, to whichever thread is
+		free next. Which thread handles which block can change from run to
+		run, so anything run through the pool must only write to data owned
+		by its indices (or to per-thread scratch space that is merged in
+		block order afterwards) for the results to stay the same every time.
+		*/
+		class WorkerPool	{
+		public:
+			typedef std::function<void(int begin, int end, int thread)> RangeFunc;
+
+			WorkerPool(int threadCount);
+			~WorkerPool();
+
+			int GetThreadCount() const {
+				return (int)workers.size() + 1;
+			}
+
+			//Calls func on blocks of up to blockSize indices, until [0, count) has been covered
+			void ParallelFor(int count, int blockSize, const RangeFunc& func);
+
+		protected:
+			void WorkerLoop(int thread);
+			void RunBlocks(int thread);
+
+			std::vector<std::thread>	workers;
+			std::mutex					jobMutex;
+			std::condition_variable		jobStart;
+			std::condition_variable		jobDone;
+
+			const RangeFunc*	jobFunc;
+			int					jobCount;
+			int					jobBlockSize;
+			int					jobGeneration;
+			int					busyWorkers;
+			bool				shuttingDown;
+			std::atomic<int>	nextBlock;
+		};
+	}
+}
@@ -1,5 +1,6 @@
 #include "GameTechRenderer.h"
 #include "../CSC8503Common/GameObject.h"
+#include "../CSC8503Common/PhysicsObject.h"
 #include "../../Common/Camera.h"
 #include "../../Common/Vector2.h"
 #include "../../Common/Vector3.h"
@@ -15,6 +16,8 @@ Matrix4 biasMatrix = Matrix4::Translation(Vector3(0.5, 0.5, 0.5)) * Matrix4::Sca
 GameTechRenderer::GameTechRenderer(GameWorld& world) : OGLRenderer(*Window::GetWindow()), gameWorld(world)	{
 	glEnable(GL_DEPTH_TEST);
 
+	interpolation = 1.0f;
+
 	shadowShader = new OGLShader("GameTechShadowVert.glsl", "GameTechShadowFrag.glsl");
 
 	glGenTextures(1, &shadowTex);
@@ -108,15 +111,23 @@ void GameTechRenderer::RenderFrame() {
 	glDisable(GL_CULL_FACE); //Todo - text indices are going the wrong way...
 }
 
+/*
+Objects with physics are drawn part of the way between where the last two
+substeps put them, so they move smoothly even when the frames don't line up
+with the substeps. Everything else is just drawn where its Transform is.
+*/
 void GameTechRenderer::BuildObjectList() {
 	activeObjects.clear();
+	modelMatrices.clear();
 
 	gameWorld.OperateOnContents(
 		[&](GameObject* o) {
 			if (o->IsActive()) {
 				const RenderObject* g = o->GetRenderObject();
 				if (g) {
+					const PhysicsObject* physics = o->GetPhysicsObject();
 					activeObjects.emplace_back(g);
+					modelMatrices.emplace_back(physics ? physics->GetInterpolatedMatrix(interpolation) : g->GetTransform()->GetMatrix());
 				}
 			}
 		}
@@ -145,8 +156,9 @@ void GameTechRenderer::RenderShadowMap() {
 
 	shadowMatrix = biasMatrix * mvMatrix; //we'll use this one later on
 
-	for (const auto&i : activeObjects) {
-		Matrix4 modelMatrix = (*i).GetTransform()->GetMatrix();
+	for (size_t j = 0; j < activeObjects.size(); ++j) {
+		const RenderObject* i = activeObjects[j];
+		Matrix4 modelMatrix = modelMatrices[j];
 		Matrix4 mvpMatrix	= mvMatrix * modelMatrix;
 		glUniformMatrix4fv(mvpLocation, 1, false, (float*)&mvpMatrix);
 		BindMesh((*i).GetMesh());
@@ -216,7 +228,8 @@ void GameTechRenderer::RenderCamera() {
 	glActiveTexture(GL_TEXTURE0 + 1);
 	glBindTexture(GL_TEXTURE_2D, shadowTex);
 
-	for (const auto&i : activeObjects) {
+	for (size_t j = 0; j < activeObjects.size(); ++j) {
+		const RenderObject* i = activeObjects[j];
 		OGLShader* shader = (OGLShader*)(*i).GetShader();
 		BindShader(shader);
 
@@ -251,7 +264,7 @@ void GameTechRenderer::RenderCamera() {
 			activeShader = shader;
 		}
 
-		Matrix4 modelMatrix = (*i).GetTransform()->GetMatrix();
+		Matrix4 modelMatrix = modelMatrices[j];
 		glUniformMatrix4fv(modelLocation, 1, false, (float*)&modelMatrix);			
 		
 		Matrix4 fullShadowMat = shadowMatrix * modelMatrix;
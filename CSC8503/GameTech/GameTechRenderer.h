@@ -17,6 +17,11 @@ namespace NCL {
 			GameTechRenderer(GameWorld& world);
 			~GameTechRenderer();
 
+			//How far between the physics system's last two substeps to draw moving objects
+			void SetInterpolation(float alpha) {
+				interpolation = alpha;
+			}
+
 		protected:
 			void RenderFrame()	override;
 
@@ -36,6 +41,8 @@ namespace NCL {
 			void LoadSkybox();
 
 			vector<const RenderObject*> activeObjects;
+			vector<Matrix4>				modelMatrices;	//one for each of the activeObjects
+			float						interpolation;
 
 			OGLShader*  skyboxShader;
 			OGLMesh*	skyboxMesh;
@@ -10,6 +10,7 @@
 #include "../CSC8503Common/BehaviourAction.h"
 #include "../CSC8503Common/NavigationGrid.cpp"
 #include "../CSC8503Common/BehaviourSequence.h"
+#include <fstream>
 
 using namespace NCL;
 using namespace CSC8503;
@@ -176,9 +177,12 @@ void TutorialGame::UpdateGame(float dt) {
 	SelectObject();
 	MoveSelectedObject();
 	physics->Update(dt);
+	physics->DispatchCollisionEvents();
+	renderer->SetInterpolation(physics->GetInterpolationAlpha());
 
 	if (p1Char != nullptr) {
-		Vector3 objPos = p1Char->GetTransform().GetPosition();
+		//Follow the player where it's drawn, rather than where the last substep left it
+		Vector3 objPos = p1Char->GetPhysicsObject()->GetInterpolatedMatrix(physics->GetInterpolationAlpha()).GetPositionVector();
 		Vector3 camPos = objPos + lockedOffset;
 
 		Matrix4 temp = Matrix4::BuildViewMatrix(camPos, objPos, Vector3(0,1,0));
@@ -198,6 +202,10 @@ void TutorialGame::UpdateGame(float dt) {
 		gameOver = true;
 	}
 
+	if (showPhysicsStats) {
+		DrawPhysicsStats();
+	}
+
 	world->UpdateWorld(dt);
 	renderer->Update(dt);
 
@@ -225,6 +233,16 @@ void TutorialGame::UpdateKeys(float dt) {
 		InitCamera(); //F2 will reset the camera to a specific default place
 	}
 
+	if (Window::GetKeyboard()->KeyPressed(KeyboardKeys::F3)) {
+		showPhysicsStats = !showPhysicsStats; //F3 shows what the physics is spending its time on
+	}
+
+	if (Window::GetKeyboard()->KeyPressed(KeyboardKeys::F4)) {
+		std::ofstream file("physics_stats.csv");
+		physics->GetStats().WriteCSV(file);
+		std::cout << "Wrote " << physics->GetStats().GetCount() << " substeps of physics stats to physics_stats.csv" << std::endl;
+	}
+
 	//Running certain physics updates in a consistent order might cause some
 	//bias in the calculations - the same objects might keep 'winning' the constraint
 	//allowing the other one to stretch too much etc. Shuffling the order so that it
@@ -249,6 +267,35 @@ void TutorialGame::UpdateKeys(float dt) {
 	}
 }
 
+/*
+The stats are averaged over the last second or so of substeps, as the
+numbers from a single substep change too quickly to read.
+*/
+void TutorialGame::DrawPhysicsStats() {
+	const PhysicsStatsHistory& history = physics->GetStats();
+	if (history.GetCount() == 0) {
+		return;
+	}
+	PhysicsStepStats s = history.GetAverage(physics->GetFixedRate());
+
+	auto ms = [](float time) {
+		std::string text = std::to_string(time);
+		return text.substr(0, text.find('.') + 3) + "ms";
+	};
+	std::string lines[] = {
+		"Broadphase: "	+ ms(s.broadphaseMS)	+ " Narrowphase: " + ms(s.narrowphaseMS),
+		"Islands: "		+ ms(s.islandsMS)		+ " Solve: " + ms(s.solveMS),
+		"Constraints: " + ms(s.constraintsMS)	+ " Integrate: " + ms(s.integrateMS),
+		"Substep: "		+ ms(s.GetTotalMS()),
+		"Proxies: "		+ std::to_string(s.proxies)		+ " Pairs: " + std::to_string(s.candidatePairs),
+		"Contacts: "	+ std::to_string(s.contacts)	+ " Rows: " + std::to_string(s.solverRows),
+		"Constraints: " + std::to_string(s.constraintsSolved) + " Awake: " + std::to_string(s.awakeBodies)
+	};
+	for (int i = 0; i < 7; ++i) {
+		Debug::Print(lines[i], Vector2(2, 60 + 5 * i), Debug::YELLOW);
+	}
+}
+
 void TutorialGame::PlayerControls(float dt) {
 	Matrix4 view = world->GetMainCamera()->BuildViewMatrix();
 	Matrix4 camWorld = view.Inverse();
@@ -327,10 +374,10 @@ void TutorialGame::InitGame() {
 	AddCubeToWorld(Vector3(17, 7, -10), Vector3(15, 5, 2), 0, TextureColour::RED);
 	AddCubeToWorld(Vector3(17, 7, -32), Vector3(15, 5, 2), 0, TextureColour::RED);
 	AddCubeToWorld(Vector3(30, 7, -60), Vector3(2, 5, 30), 0, TextureColour::RED);
-	AddSphereToWorld(Vector3(19, 7, -5), 2, 2.0f, false);
-	AddSphereToWorld(Vector3(45, 7, -5), 2, 2.0f, false);
-	AddCubeToWorld(Vector3(22, 7, -20), Vector3(3, 3, 3), 3.0f, TextureColour::RED);
-	AddCubeToWorld(Vector3(17, 7, -20), Vector3(3, 3, 3), 3.0f, TextureColour::RED);
+	AddSphereToWorld(Vector3(19, 7, -5), 2, 2.0f, false)->GetPhysicsObject()->SetContinuous(true);	// obstacles that get flung about
+	AddSphereToWorld(Vector3(45, 7, -5), 2, 2.0f, false)->GetPhysicsObject()->SetContinuous(true);
+	AddCubeToWorld(Vector3(22, 7, -20), Vector3(3, 3, 3), 3.0f, TextureColour::RED)->GetPhysicsObject()->SetContinuous(true);
+	AddCubeToWorld(Vector3(17, 7, -20), Vector3(3, 3, 3), 3.0f, TextureColour::RED)->GetPhysicsObject()->SetContinuous(true);
 	AddBonusToWorld(Vector3(42, 8, 0));
 
 	// big room
@@ -349,6 +396,7 @@ void TutorialGame::InitGame() {
 	SetupBridge();
 
 	finish = AddFloorToWorld(Vector3(330, -60, -60), Vector3(50, 3, 20), TextureColour::BLUE);
+	AddFinishToWorld(Vector3(330, -55, -60), Vector3(50, 2, 20));
 
 	switch (players) {
 	case 2:
@@ -489,8 +537,8 @@ GameObject* TutorialGame::AddFloorToWorld(const Vector3& position, const Vector3
 	}
 
 	floor->SetPhysicsObject(new PhysicsObject(&floor->GetTransform(), floor->GetBoundingVolume()));
-	floor->GetPhysicsObject()->SetInverseMass(0);
-	floor->GetPhysicsObject()->InitCubeInertia();
+	floor->GetPhysicsObject()->SetBodyType(BodyType::Static);
+	floor->SetCollisionLayer(CollisionLayer::Static);
 	world->AddGameObject(floor);
 
 	return floor;
@@ -520,6 +568,10 @@ GameObject* TutorialGame::AddSphereToWorld(const Vector3& position, float radius
 
 	sphere->GetPhysicsObject()->SetInverseMass(inverseMass);
 	solid ? sphere->GetPhysicsObject()->InitSolidSphereInertia() : sphere->GetPhysicsObject()->InitHollowSphereInertia();
+	if (inverseMass == 0) {
+		sphere->GetPhysicsObject()->SetBodyType(BodyType::Static);
+	}
+	sphere->SetCollisionLayer(inverseMass == 0 ? CollisionLayer::Static : CollisionLayer::Obstacle);
 
 	world->AddGameObject(sphere);
 
@@ -541,6 +593,10 @@ GameObject* TutorialGame::AddCapsuleToWorld(const Vector3& position, float halfH
 
 	capsule->GetPhysicsObject()->SetInverseMass(inverseMass);
 	capsule->GetPhysicsObject()->InitCubeInertia();
+	if (inverseMass == 0) {
+		capsule->GetPhysicsObject()->SetBodyType(BodyType::Static);
+	}
+	capsule->SetCollisionLayer(inverseMass == 0 ? CollisionLayer::Static : CollisionLayer::Obstacle);
 
 	world->AddGameObject(capsule);
 
@@ -562,6 +618,10 @@ GameObject* TutorialGame::AddCubeToWorld(const Vector3& position, Vector3 dimens
 	cube->SetPhysicsObject(new PhysicsObject(&cube->GetTransform(), cube->GetBoundingVolume()));
 	cube->GetPhysicsObject()->SetInverseMass(inverseMass);
 	cube->GetPhysicsObject()->InitCubeInertia();
+	if (inverseMass == 0) {
+		cube->GetPhysicsObject()->SetBodyType(BodyType::Static);
+	}
+	cube->SetCollisionLayer(inverseMass == 0 ? CollisionLayer::Static : CollisionLayer::Obstacle);
 	switch (textureID) {
 	case TextureColour::RED:
 		cube->GetRenderObject()->SetColour(Vector4(1, 0, 0, 1));
@@ -571,6 +631,7 @@ GameObject* TutorialGame::AddCubeToWorld(const Vector3& position, Vector3 dimens
 		break;
 	case TextureColour::PURPLE:
 		cube->SetName("slippery");
+		cube->GetPhysicsObject()->SetElasticity(35.0f);
 		cube->GetRenderObject()->SetColour(Vector4(0.5f, 0, 0.5f, 1));
 		break;
 	case TextureColour::BLUE:
@@ -671,6 +732,8 @@ GameObject* TutorialGame::AddPlayerToWorld(const Vector3& position, const std::s
 
 	character->GetPhysicsObject()->SetInverseMass(inverseMass);
 	character->GetPhysicsObject()->InitSolidSphereInertia();
+	character->GetPhysicsObject()->SetContinuous(true);	// players move fast enough to fall through the floors
+	character->SetCollisionLayer(CollisionLayer::Player);
 
 	world->AddGameObject(character);
 	return character;
@@ -713,14 +776,70 @@ GameObject* TutorialGame::AddBonusToWorld(const Vector3& position) {
 	bonus->GetRenderObject()->SetColour(Vector4(1, 0, 0, 1));
 
 	bonus->SetPhysicsObject(new PhysicsObject(&bonus->GetTransform(), bonus->GetBoundingVolume()));
-	bonus->GetPhysicsObject()->SetInverseMass(0.0f);
-	bonus->GetPhysicsObject()->InitSolidSphereInertia();
+	bonus->GetPhysicsObject()->SetBodyType(BodyType::Kinematic);	//it's moved out of the way once collected
+	bonus->GetPhysicsObject()->SetSensor(true);
+	bonus->SetCollisionLayer(CollisionLayer::Bonus);
 
 	world->AddGameObject(bonus);
 
+	physics->AddSensorListener(bonus->GetWorldID(), [this](GameObject* sensor, GameObject* other, bool entered) {
+		int player = GetPlayerIndex(other);
+		if (entered && player != -1) {
+			CollectBonus(player, sensor);
+		}
+	});
+
 	return bonus;
 }
 
+/*
+An invisible sensor sitting on top of the finish floor. Any player that
+lands in it has won.
+*/
+GameObject* TutorialGame::AddFinishToWorld(const Vector3& position, const Vector3& size) {
+	GameObject* line = new GameObject("finish line");
+
+	AABBVolume* volume = new AABBVolume(size);
+	line->SetBoundingVolume((CollisionVolume*)volume);
+	line->GetTransform()
+		.SetScale(size * 2)
+		.SetPosition(position);
+
+	line->SetPhysicsObject(new PhysicsObject(&line->GetTransform(), line->GetBoundingVolume()));
+	line->GetPhysicsObject()->SetBodyType(BodyType::Static);
+	line->GetPhysicsObject()->SetSensor(true);
+	line->SetCollisionLayer(CollisionLayer::Static);
+	line->SetCollisionMask(CollisionLayerMatrix::GetCategory(CollisionLayer::Player));
+
+	world->AddGameObject(line);
+
+	physics->AddSensorListener(line->GetWorldID(), [this](GameObject* sensor, GameObject* other, bool entered) {
+		if (entered && GetPlayerIndex(other) != -1) {
+			other->win = true;
+		}
+	});
+	return line;
+}
+
+//Which player an object is, from 0, or -1 if it isn't one
+int TutorialGame::GetPlayerIndex(const GameObject* o) const {
+	const GameObject* characters[4] = { p1Char, p2Char, p3Char, p4Char };
+	for (int i = 0; i < 4; ++i) {
+		if (characters[i] && characters[i] == o) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+//The bonus is moved out of the way and hidden, rather than removed from the world in the middle of an update
+void TutorialGame::CollectBonus(int player, GameObject* bonus) {
+	bonus->GetTransform().SetPosition(Vector3(0, 200, 0));
+	bonus->GetRenderObject()->SetColour(Vector4(0, 0, 0, 0));
+
+	world->playerScores[player] += 30;
+}
+
 StateGameObject* TutorialGame::AddStateObjectToWorld(const Vector3& position) {
 	StateGameObject* stateObj = new StateGameObject();
 
@@ -733,8 +852,7 @@ StateGameObject* TutorialGame::AddStateObjectToWorld(const Vector3& position) {
 	stateObj->SetRenderObject(new RenderObject(&stateObj->GetTransform(), bonusMesh, nullptr, basicShader));
 	stateObj->SetPhysicsObject(new PhysicsObject(&stateObj->GetTransform(), stateObj->GetBoundingVolume()));
 
-	stateObj->GetPhysicsObject()->SetInverseMass(1.0f);
-	stateObj->GetPhysicsObject()->InitSolidSphereInertia();
+	stateObj->GetPhysicsObject()->SetBodyType(BodyType::Kinematic);
 
 	world->AddGameObject(stateObj);
 
@@ -42,6 +42,7 @@ namespace NCL {
 			void MoveSelectedObject();
 			void DebugObjectMovement();
 			void PlayerControls(float dt);
+			void DrawPhysicsStats();
 
 			GameObject* AddFloorToWorld(const Vector3& position, const Vector3& size, TextureColour textureID = (TextureColour)0);
 			GameObject* AddSphereToWorld(const Vector3& position, float radius, float inverseMass = 10.0f, bool solid = true);
@@ -52,6 +53,7 @@ namespace NCL {
 			GameObject* AddPlayerToWorld(const Vector3& position, const std::string& name);
 			GameObject* AddEnemyToWorld(const Vector3& position);
 			GameObject* AddBonusToWorld(const Vector3& position);
+			GameObject* AddFinishToWorld(const Vector3& position, const Vector3& size);
 
 			GameObject* finish;
 
@@ -74,6 +76,7 @@ namespace NCL {
 
 			bool useGravity			= true;
 			bool inSelectionMode;
+			bool showPhysicsStats	= false;
 
 			GameObject* selectionObject = nullptr;
 
@@ -106,6 +109,9 @@ namespace NCL {
 			Vector2 distanceToNode;
 			void AIBehaviourTree(float dt);
 			void GeneratePath();
+
+			int  GetPlayerIndex(const GameObject* o) const;
+			void CollectBonus(int player, GameObject* bonus);
 		};
 	}
 }
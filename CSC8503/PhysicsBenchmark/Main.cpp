@@ -0,0 +1,316 @@
+#include "../CSC8503Common/GameWorld.h"
+#include "../CSC8503Common/GameObject.h"
+#include "../CSC8503Common/QuadTree.h"
+#include "../CSC8503Common/QuadTreeBroadPhase.h"
+#include "../CSC8503Common/AABBTreeBroadPhase.h"
+#include "../CSC8503Common/SweepAndPruneBroadPhase.h"
+#include "../CSC8503Common/HashGridBroadPhase.h"
+#include "../../Common/GameTimer.h"
+#include "SceneBenchmark.h"
+#include <iostream>
+#include <string>
+#include <functional>
+#include <set>
+#include <vector>
+#include <algorithm>
+
+using namespace NCL;
+using namespace CSC8503;
+
+/*
+
+Compares the persistent broadphases against the original approach of building
+a brand new QuadTree every physics substep. The first world is an obstacle
+course style layout - lots of static boxes, with a smaller number of objects
+moving around between them. The second is every player crowded together at
+the start line.
+
+Every substep, each persistent broadphase has to find exactly the same
+overlapping pairs as the rebuilt QuadTree, or the benchmark fails, so the
+speedups are always measured on the same output.
+
+Usage: PhysicsBenchmark [obstacles] [movers] [substeps] [players]
+
+PhysicsBenchmark scenes runs the whole physics system instead, see SceneBenchmark.h
+
+*/
+
+struct BenchmarkScene {
+	GameWorld world;
+	std::vector<GameObject*> movers;
+	std::vector<Vector3> velocities;
+	float bounds = 900.0f;
+};
+
+float RandomRange(float min, float max) {
+	return min + (max - min) * ((float)rand() / (float)RAND_MAX);
+}
+
+GameObject* AddBoxToScene(BenchmarkScene& scene, const Vector3& position, const Vector3& halfSize) {
+	GameObject* box = new GameObject("obstacle");
+	box->SetBoundingVolume((CollisionVolume*)new AABBVolume(halfSize));
+	box->GetTransform()
+		.SetScale(halfSize * 2)
+		.SetPosition(position);
+	box->UpdateBroadphaseAABB();
+	scene.world.AddGameObject(box);
+	return box;
+}
+
+void BuildScene(BenchmarkScene& scene, int obstacleCount, int moverCount) {
+	srand(1234);
+	for (int i = 0; i < obstacleCount; ++i) {
+		Vector3 position(RandomRange(-900, 900), RandomRange(0, 20), RandomRange(-900, 900));
+		Vector3 halfSize(RandomRange(1, 6), RandomRange(1, 4), RandomRange(1, 6));
+		AddBoxToScene(scene, position, halfSize);
+	}
+	for (int i = 0; i < moverCount; ++i) {
+		Vector3 position(RandomRange(-900, 900), 5, RandomRange(-900, 900));
+		scene.movers.emplace_back(AddBoxToScene(scene, position, Vector3(1, 1, 1)));
+		scene.velocities.emplace_back(Vector3(RandomRange(-20, 20), 0, RandomRange(-20, 20)));
+	}
+}
+
+/*
+Players are packed in rows a little under a body width apart, and stand
+slightly into the floor, like resting contacts do, so every player starts
+off overlapping the floor and its neighbours, and then jostles around.
+*/
+void BuildCrowdScene(BenchmarkScene& scene, int playerCount) {
+	srand(1234);
+	scene.bounds = 20.0f;
+	AddBoxToScene(scene, Vector3(0, -2, 0), Vector3(100, 1, 100));
+
+	int rowLength = 12;
+	for (int i = 0; i < playerCount; ++i) {
+		Vector3 position(-9.9f + (i % rowLength) * 1.8f, 0.95f, (i / rowLength) * 1.8f);
+		scene.movers.emplace_back(AddBoxToScene(scene, position, Vector3(1, 2, 1)));
+		scene.velocities.emplace_back(Vector3(RandomRange(-2, 2), 0, RandomRange(-2, 2)));
+	}
+}
+
+void MoveScene(BenchmarkScene& scene, float dt) {
+	for (size_t i = 0; i < scene.movers.size(); ++i) {
+		Transform& t = scene.movers[i]->GetTransform();
+		Vector3 position = t.GetPosition() + scene.velocities[i] * dt;
+		if (std::abs(position.x) > scene.bounds) {
+			scene.velocities[i].x = -scene.velocities[i].x;
+		}
+		if (std::abs(position.z) > scene.bounds) {
+			scene.velocities[i].z = -scene.velocities[i].z;
+		}
+		t.SetPosition(position);
+	}
+}
+
+//This is exactly what PhysicsSystem::BroadPhase used to do every substep
+void RebuildBroadPhase(GameWorld& world, std::set<CollisionDetection::CollisionInfo>& pairs) {
+	pairs.clear();
+	QuadTree<GameObject*> tree(Vector2(1024, 1024), 7, 6);
+
+	GameObjectIterator first;
+	GameObjectIterator last;
+	world.GetObjectIterators(first, last);
+
+	for (auto i = first; i != last; ++i) {
+		Vector3 halfSizes;
+		if (!(*i)->GetBroadphaseAABB(halfSizes)) {
+			continue;
+		}
+		Vector3 pos = (*i)->GetTransform().GetPosition();
+		tree.Insert(*i, pos, halfSizes);
+	}
+
+	tree.OperateOnContents([&](std::list<QuadTreeEntry<GameObject*>>& data) {
+		CollisionDetection::CollisionInfo info;
+
+		for (auto i = data.begin(); i != data.end(); ++i) {
+			for (auto j = std::next(i); j != data.end(); ++j) {
+				bool inOrder = (*i).object < (*j).object;
+				info.a = inOrder ? (*i).object : (*j).object;
+				info.b = inOrder ? (*j).object : (*i).object;
+				pairs.insert(info);
+			}
+		}
+	});
+}
+
+//And this is what it does now
+void PersistentBroadPhase(GameWorld& world, BroadPhaseStructure& broadPhase, PairBuffer& pairs) {
+	bool incremental = broadPhase.IsIncremental();
+	if (!incremental) {
+		pairs.Clear();
+	}
+
+	GameObjectIterator first;
+	GameObjectIterator last;
+	world.GetObjectIterators(first, last);
+
+	broadPhase.UpdateProxies(first, last);
+	broadPhase.FindPairs(pairs);
+
+	if (!incremental) {
+		pairs.SortAndRemoveDuplicates();
+	}
+}
+
+typedef std::vector<PairKey> OverlapSet;
+
+//Whether two objects' AABBs really overlap, rather than just being near each other
+bool AABBsOverlap(GameObject* a, GameObject* b) {
+	Vector3 halfA;
+	Vector3 halfB;
+	a->GetBroadphaseAABB(halfA);
+	b->GetBroadphaseAABB(halfB);
+	Vector3 delta = a->GetTransform().GetPosition() - b->GetTransform().GetPosition();
+	return std::abs(delta.x) < halfA.x + halfB.x
+		&& std::abs(delta.y) < halfA.y + halfB.y
+		&& std::abs(delta.z) < halfA.z + halfB.z;
+}
+
+void AddOverlap(OverlapSet& overlaps, GameObject* a, GameObject* b) {
+	if (AABBsOverlap(a, b)) {
+		overlaps.emplace_back(MakePairKey(a, b));
+	}
+}
+
+//Sorted, so that the sets found by different broadphases can be compared
+void FinishOverlaps(OverlapSet& overlaps) {
+	std::sort(overlaps.begin(), overlaps.end());
+	overlaps.erase(std::unique(overlaps.begin(), overlaps.end()), overlaps.end());
+}
+
+/*
+Only the broadphase itself is timed. The candidate pairs it found are then
+filtered down to the ones that really overlap, which is what every
+broadphase should agree on, however many extra candidates it passes on.
+*/
+struct BroadPhaseRun {
+	float	seconds			= 0.0f;
+	size_t	pairTotal		= 0;	//candidate pairs, as the broadphase found them
+	size_t	overlapTotal	= 0;	//candidate pairs that really overlap
+	std::vector<OverlapSet> overlaps;	//for each substep
+};
+
+BroadPhaseRun RunRebuildBroadPhase(std::function<void(BenchmarkScene&)> build, int substeps, float dt) {
+	std::set<CollisionDetection::CollisionInfo> pairs;
+	BroadPhaseRun run;
+
+	BenchmarkScene scene;
+	build(scene);
+	GameTimer t;
+	for (int i = 0; i < substeps; ++i) {
+		MoveScene(scene, dt);
+		t.Tick();
+		RebuildBroadPhase(scene.world, pairs);
+		t.Tick();
+		run.seconds		+= t.GetTimeDeltaSeconds();
+		run.pairTotal	+= pairs.size();
+
+		OverlapSet overlaps;
+		for (const CollisionDetection::CollisionInfo& info : pairs) {
+			AddOverlap(overlaps, info.a, info.b);
+		}
+		FinishOverlaps(overlaps);
+		run.overlapTotal += overlaps.size();
+		run.overlaps.emplace_back(std::move(overlaps));
+	}
+	scene.world.ClearAndErase();
+	return run;
+}
+
+BroadPhaseRun RunPersistentBroadPhase(BroadPhaseStructure& broadPhase, std::function<void(BenchmarkScene&)> build, int substeps, float dt) {
+	PairBuffer pairs;
+	BroadPhaseRun run;
+
+	BenchmarkScene scene;
+	build(scene);
+	GameTimer t;
+	for (int i = 0; i < substeps; ++i) {
+		MoveScene(scene, dt);
+		t.Tick();
+		PersistentBroadPhase(scene.world, broadPhase, pairs);
+		t.Tick();
+		run.seconds		+= t.GetTimeDeltaSeconds();
+		run.pairTotal	+= pairs.GetCount();
+
+		OverlapSet overlaps;
+		for (const BroadPhasePair& pair : pairs) {
+			AddOverlap(overlaps, pair.a, pair.b);
+		}
+		FinishOverlaps(overlaps);
+		run.overlapTotal += overlaps.size();
+		run.overlaps.emplace_back(std::move(overlaps));
+	}
+	scene.world.ClearAndErase();
+	return run;
+}
+
+//Every broadphase must find exactly the overlapping pairs the rebuilt QuadTree does
+bool MatchesReference(const std::string& name, const BroadPhaseRun& run, const BroadPhaseRun& reference) {
+	for (size_t i = 0; i < reference.overlaps.size(); ++i) {
+		if (run.overlaps[i] != reference.overlaps[i]) {
+			std::cout << name << "MISMATCH at substep " << i << ": found " << run.overlaps[i].size()
+				<< " overlapping pairs, expected " << reference.overlaps[i].size() << std::endl;
+			return false;
+		}
+	}
+	return true;
+}
+
+void PrintResult(const std::string& name, const BroadPhaseRun& run, const BroadPhaseRun& reference, int substeps) {
+	std::cout << name << (run.seconds * 1000.0f) / substeps << "ms per substep, "
+		<< run.pairTotal / substeps << " pairs, "
+		<< run.overlapTotal / substeps << " overlapping per substep, "
+		<< reference.seconds / run.seconds << "x speedup" << std::endl;
+}
+
+bool RunPersistentScene(const std::string& name, BroadPhaseStructure& broadPhase, std::function<void(BenchmarkScene&)> build,
+	int substeps, float dt, const BroadPhaseRun& reference) {
+	BroadPhaseRun run = RunPersistentBroadPhase(broadPhase, build, substeps, dt);
+	PrintResult(name, run, reference, substeps);
+	return MatchesReference(name, run, reference);
+}
+
+bool RunScene(std::function<void(BenchmarkScene&)> build, int substeps, float dt) {
+	BroadPhaseRun reference = RunRebuildBroadPhase(build, substeps, dt);
+	PrintResult("Rebuilt QuadTree:    ", reference, reference, substeps);
+
+	bool matched = true;
+
+	QuadTreeBroadPhase quadTree(Vector2(1024, 1024), 7, 6);
+	matched &= RunPersistentScene("Persistent QuadTree: ", quadTree, build, substeps, dt, reference);
+
+	AABBTreeBroadPhase aabbTree(0.5f);
+	matched &= RunPersistentScene("AABB tree:           ", aabbTree, build, substeps, dt, reference);
+
+	SweepAndPruneBroadPhase sweepAndPrune;
+	matched &= RunPersistentScene("Sweep and prune:     ", sweepAndPrune, build, substeps, dt, reference);
+
+	HashGridBroadPhase hashGrid({ 4.0f, 16.0f, 64.0f }, 4096);
+	matched &= RunPersistentScene("Hash grid:           ", hashGrid, build, substeps, dt, reference);
+
+	return matched;
+}
+
+int main(int argc, char** argv) {
+	if (argc > 1 && std::string(argv[1]) == "scenes") {
+		return RunSceneBenchmarks(argc - 2, argv + 2);
+	}
+
+	int obstacleCount	= argc > 1 ? std::stoi(argv[1]) : 2000;
+	int moverCount		= argc > 2 ? std::stoi(argv[2]) : 200;
+	int substeps		= argc > 3 ? std::stoi(argv[3]) : 600;
+	int playerCount		= argc > 4 ? std::stoi(argv[4]) : 60;
+	const float dt		= 1.0f / 120.0f;
+
+	std::cout << "Obstacle course: " << obstacleCount << " obstacles, " << moverCount
+		<< " moving objects, " << substeps << " substeps" << std::endl;
+	bool matched = RunScene([&](BenchmarkScene& scene) { BuildScene(scene, obstacleCount, moverCount); }, substeps, dt);
+
+	std::cout << std::endl << "Start line: " << playerCount << " players, " << substeps << " substeps" << std::endl;
+	matched &= RunScene([&](BenchmarkScene& scene) { BuildCrowdScene(scene, playerCount); }, substeps, dt);
+
+	//A failure here means a broadphase is missing pairs, or finding ones that aren't there
+	return matched ? 0 : 1;
+}
@@ -0,0 +1,374 @@
+#include "SceneBenchmark.h"
+#include "../CSC8503Common/GameWorld.h"
+#include "../CSC8503Common/GameObject.h"
+#include "../CSC8503Common/PhysicsSystem.h"
+#include "../CSC8503Common/PhysicsObject.h"
+#include "../CSC8503Common/PositionConstraint.h"
+#include "../CSC8503Common/SphereVolume.h"
+#include "../CSC8503Common/AABBVolume.h"
+#include "../CSC8503Common/CapsuleVolume.h"
+#include "../../Common/GameTimer.h"
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <functional>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#endif
+
+using namespace NCL;
+using namespace CSC8503;
+
+namespace {
+	struct SceneSettings {
+		int		steps		= 600;
+		int		threads		= 1;
+		bool	sleeping	= true;
+		std::vector<int>			bodyCounts	= { 1000, 10000, 50000 };
+		std::vector<std::string>	scenes		= { "sphere", "cube", "mixed", "bridge" };
+		std::string csvPrefix;
+	};
+
+	struct MemoryUsage {
+		double residentMB	= 0.0;
+		double peakMB		= 0.0;
+	};
+
+	/*
+	How much of the process is in physical memory right now, and the most it
+	has ever been. The peak is for the whole process, so it only means much
+	for the largest scene run so far.
+	*/
+	MemoryUsage GetMemoryUsage() {
+		MemoryUsage usage;
+#ifdef _WIN32
+		PROCESS_MEMORY_COUNTERS counters;
+		if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+			usage.residentMB	= counters.WorkingSetSize / (1024.0 * 1024.0);
+			usage.peakMB		= counters.PeakWorkingSetSize / (1024.0 * 1024.0);
+		}
+#else
+		std::ifstream status("/proc/self/status");
+		std::string line;
+		while (std::getline(status, line)) {
+			std::istringstream fields(line);
+			std::string name;
+			double kilobytes = 0.0;
+			fields >> name >> kilobytes;
+			if (name == "VmRSS:") {
+				usage.residentMB = kilobytes / 1024.0;
+			}
+			else if (name == "VmHWM:") {
+				usage.peakMB = kilobytes / 1024.0;
+			}
+		}
+#endif
+		return usage;
+	}
+
+	//These match the TutorialGame functions, but without anything to draw
+	GameObject* AddFloor(GameWorld& world, const Vector3& position, const Vector3& size) {
+		GameObject* floor = new GameObject("floor");
+		floor->SetBoundingVolume((CollisionVolume*)new AABBVolume(size));
+		floor->GetTransform()
+			.SetScale(size * 2)
+			.SetPosition(position);
+		floor->SetPhysicsObject(new PhysicsObject(&floor->GetTransform(), floor->GetBoundingVolume()));
+		floor->GetPhysicsObject()->SetBodyType(BodyType::Static);
+		floor->SetCollisionLayer(CollisionLayer::Static);
+		world.AddGameObject(floor);
+		return floor;
+	}
+
+	GameObject* AddSphere(GameWorld& world, const Vector3& position, float radius, float inverseMass) {
+		GameObject* sphere = new GameObject();
+		sphere->SetBoundingVolume((CollisionVolume*)new SphereVolume(radius));
+		sphere->GetTransform()
+			.SetScale(Vector3(radius, radius, radius))
+			.SetPosition(position);
+		sphere->SetPhysicsObject(new PhysicsObject(&sphere->GetTransform(), sphere->GetBoundingVolume()));
+		sphere->GetPhysicsObject()->SetInverseMass(inverseMass);
+		sphere->GetPhysicsObject()->InitSolidSphereInertia();
+		sphere->SetCollisionLayer(CollisionLayer::Obstacle);
+		world.AddGameObject(sphere);
+		return sphere;
+	}
+
+	GameObject* AddCube(GameWorld& world, const Vector3& position, const Vector3& dimensions, float inverseMass) {
+		GameObject* cube = new GameObject();
+		cube->SetBoundingVolume((CollisionVolume*)new AABBVolume(dimensions));
+		cube->GetTransform()
+			.SetPosition(position)
+			.SetScale(dimensions * 2);
+		cube->SetPhysicsObject(new PhysicsObject(&cube->GetTransform(), cube->GetBoundingVolume()));
+		cube->GetPhysicsObject()->SetInverseMass(inverseMass);
+		cube->GetPhysicsObject()->InitCubeInertia();
+		if (inverseMass == 0) {
+			cube->GetPhysicsObject()->SetBodyType(BodyType::Static);
+		}
+		cube->SetCollisionLayer(inverseMass == 0 ? CollisionLayer::Static : CollisionLayer::Obstacle);
+		world.AddGameObject(cube);
+		return cube;
+	}
+
+	GameObject* AddCapsule(GameWorld& world, const Vector3& position, float halfHeight, float radius, float inverseMass) {
+		GameObject* capsule = new GameObject();
+		capsule->SetBoundingVolume((CollisionVolume*)new CapsuleVolume(halfHeight, radius));
+		capsule->GetTransform()
+			.SetScale(Vector3(radius * 2, halfHeight, radius * 2))
+			.SetPosition(position);
+		capsule->SetPhysicsObject(new PhysicsObject(&capsule->GetTransform(), capsule->GetBoundingVolume()));
+		capsule->GetPhysicsObject()->SetInverseMass(inverseMass);
+		capsule->GetPhysicsObject()->InitCubeInertia();
+		capsule->SetCollisionLayer(CollisionLayer::Obstacle);
+		world.AddGameObject(capsule);
+		return capsule;
+	}
+
+	/*
+	The grids are a few layers deep, so that the larger scenes don't need an
+	enormous floor, and the layers land on each other and pile up rather than
+	all settling at once.
+	*/
+	const int	gridLayers		= 4;
+	const float gridSpacing		= 3.0f;
+	const float layerSpacing	= 6.0f;
+
+	int GridSide(int bodyCount) {
+		return (int)std::ceil(std::sqrt((bodyCount + gridLayers - 1) / gridLayers));
+	}
+
+	Vector3 GridPosition(int index, int side) {
+		int layer	= index / (side * side);
+		int cell	= index % (side * side);
+		float half	= (side - 1) * gridSpacing * 0.5f;
+		return Vector3((cell % side) * gridSpacing - half, 10.0f + layer * layerSpacing, (cell / side) * gridSpacing - half);
+	}
+
+	void AddGridFloor(GameWorld& world, int side) {
+		float halfSize = side * gridSpacing * 0.5f + 10.0f;
+		AddFloor(world, Vector3(0, -2, 0), Vector3(halfSize, 2, halfSize));
+	}
+
+	void BuildSphereGrid(GameWorld& world, int bodyCount) {
+		int side = GridSide(bodyCount);
+		for (int i = 0; i < bodyCount; ++i) {
+			AddSphere(world, GridPosition(i, side), 1.0f, 1.0f);
+		}
+		AddGridFloor(world, side);
+	}
+
+	void BuildCubeGrid(GameWorld& world, int bodyCount) {
+		int side = GridSide(bodyCount);
+		for (int i = 0; i < bodyCount; ++i) {
+			AddCube(world, GridPosition(i, side), Vector3(1, 1, 1), 1.0f);
+		}
+		AddGridFloor(world, side);
+	}
+
+	void BuildMixedGrid(GameWorld& world, int bodyCount) {
+		srand(1234);
+		int side = GridSide(bodyCount);
+		for (int i = 0; i < bodyCount; ++i) {
+			Vector3 position = GridPosition(i, side);
+			switch (rand() % 3) {
+				case 0: AddCube(world, position, Vector3(1, 1, 1), 10.0f); break;
+				case 1: AddSphere(world, position, 1.0f, 10.0f); break;
+				case 2: AddCapsule(world, position, 2.0f, 1.0f, 10.0f); break;
+			}
+		}
+		AddGridFloor(world, side);
+	}
+
+	/*
+	Rows of bridges like SetupBridge's, each a chain of light cubes hung
+	between two static ones. Only the links count towards the bodies.
+	*/
+	void BuildBridges(GameWorld& world, int bodyCount) {
+		const int	linksPerBridge	= 20;
+		const float linkDistance	= 2.0f;
+		const float maxDistance		= 2.5f;
+		const Vector3 linkSize		= Vector3(0.5f, 0.5f, 0.5f);
+
+		int bridgeCount		= (bodyCount + linksPerBridge - 1) / linksPerBridge;
+		int bridgesPerRow	= (int)std::ceil(std::sqrt((float)bridgeCount));
+		float bridgeLength	= (linksPerBridge + 1) * linkDistance;
+
+		int linksLeft = bodyCount;
+		for (int i = 0; i < bridgeCount; ++i) {
+			int links = linksLeft < linksPerBridge ? linksLeft : linksPerBridge;
+			linksLeft -= links;
+
+			Vector3 startPos((i % bridgesPerRow) * (bridgeLength + 10.0f), 0, (i / bridgesPerRow) * 4.0f);
+			GameObject* start	= AddCube(world, startPos, linkSize, 0.0f);
+			GameObject* end		= AddCube(world, startPos + Vector3((links + 1) * linkDistance, 0, 0), linkSize, 0.0f);
+
+			GameObject* previous = start;
+			for (int j = 0; j < links; ++j) {
+				GameObject* block = AddCube(world, startPos + Vector3((j + 1) * linkDistance, 0, 0), linkSize, 2.0f);
+				world.AddConstraint(new PositionConstraint(previous, block, maxDistance));
+				previous = block;
+			}
+			world.AddConstraint(new PositionConstraint(previous, end, maxDistance));
+		}
+	}
+
+	std::function<void(GameWorld&, int)> FindScene(const std::string& name) {
+		if (name == "sphere")	return BuildSphereGrid;
+		if (name == "cube")		return BuildCubeGrid;
+		if (name == "mixed")	return BuildMixedGrid;
+		if (name == "bridge")	return BuildBridges;
+		return nullptr;
+	}
+
+	std::vector<std::string> SplitList(const std::string& list) {
+		std::vector<std::string> items;
+		std::istringstream stream(list);
+		std::string item;
+		while (std::getline(stream, item, ',')) {
+			items.emplace_back(item);
+		}
+		return items;
+	}
+
+	bool ParseSettings(int argc, char** argv, SceneSettings& settings) {
+		for (int i = 0; i < argc; ++i) {
+			std::string arg		= argv[i];
+			bool hasValue		= i + 1 < argc;
+			if (arg == "--steps" && hasValue) {
+				settings.steps = std::stoi(argv[++i]);
+			}
+			else if (arg == "--threads" && hasValue) {
+				settings.threads = std::stoi(argv[++i]);
+			}
+			else if (arg == "--bodies" && hasValue) {
+				settings.bodyCounts.clear();
+				for (const std::string& count : SplitList(argv[++i])) {
+					settings.bodyCounts.emplace_back(std::stoi(count));
+				}
+			}
+			else if (arg == "--scenes" && hasValue) {
+				settings.scenes = SplitList(argv[++i]);
+			}
+			else if (arg == "--csv" && hasValue) {
+				settings.csvPrefix = argv[++i];
+			}
+			else if (arg == "--no-sleep") {
+				settings.sleeping = false;
+			}
+			else {
+				std::cerr << "Unknown or incomplete argument " << arg << std::endl;
+				return false;
+			}
+		}
+		for (const std::string& scene : settings.scenes) {
+			if (!FindScene(scene)) {
+				std::cerr << "Unknown scene " << scene << std::endl;
+				return false;
+			}
+		}
+		return settings.steps > 0;
+	}
+
+	//The step time that the given fraction of steps were at least as fast as
+	float Percentile(const std::vector<float>& sortedTimes, float fraction) {
+		int index = (int)std::ceil(fraction * sortedTimes.size()) - 1;
+		return sortedTimes[index < 0 ? 0 : index];
+	}
+
+	/*
+	Each step is a whole frame at the physics rate, so it runs exactly one
+	substep, and is followed by everything else the game does with physics
+	each frame, which is handing out its events and rebuilding the matrices
+	of everything that moved.
+	*/
+	void RunScene(const SceneSettings& settings, const std::string& name, int bodyCount) {
+		MemoryUsage before = GetMemoryUsage();
+
+		GameWorld world;
+		PhysicsSystem* physics = new PhysicsSystem(world);
+		physics->SetThreadCount(settings.threads);
+		physics->UseSleeping(settings.sleeping);
+		physics->SetStatsHistoryLength(settings.steps);
+		FindScene(name)(world, bodyCount);
+
+		float dt = physics->GetFixedTimestep();
+		std::vector<float> stepTimes;
+		stepTimes.reserve(settings.steps);
+
+		GameTimer timer;
+		GameTimer stepTimer;
+		for (int i = 0; i < settings.steps; ++i) {
+			stepTimer.Tick();
+			physics->Update(dt);
+			physics->DispatchCollisionEvents();
+			world.UpdateWorld(dt);
+			stepTimer.Tick();
+			stepTimes.emplace_back(stepTimer.GetTimeDeltaMSec());
+		}
+		timer.Tick();
+		MemoryUsage after = GetMemoryUsage();
+
+		const PhysicsStatsHistory& stats = physics->GetStats();
+		PhysicsStepStats average	= stats.GetAverage(stats.GetCount());
+		PhysicsStepStats last		= stats.GetLatest();
+
+		if (!settings.csvPrefix.empty()) {
+			std::ofstream csv(settings.csvPrefix + name + "_" + std::to_string(bodyCount) + ".csv");
+			stats.WriteCSV(csv);
+		}
+
+		float seconds = timer.GetTimeDeltaSeconds();
+		std::sort(stepTimes.begin(), stepTimes.end());
+
+		std::cout << std::fixed << std::setprecision(2)
+			<< std::left << std::setw(7) << name << std::right << std::setw(7) << bodyCount << " bodies: "
+			<< settings.steps << " steps in " << seconds << "s, "
+			<< settings.steps / seconds << " steps/s, "
+			<< (bodyCount * (double)settings.steps) / seconds / 1000000.0 << "M body-steps/s" << std::endl
+			<< "    step ms   p50 " << Percentile(stepTimes, 0.5f) << "  p90 " << Percentile(stepTimes, 0.9f)
+			<< "  p99 " << Percentile(stepTimes, 0.99f) << "  max " << stepTimes.back() << std::endl
+			<< "    phase ms  broadphase " << average.broadphaseMS << "  narrowphase " << average.narrowphaseMS
+			<< "  islands " << average.islandsMS << "  solve " << average.solveMS
+			<< "  constraints " << average.constraintsMS << "  integrate " << average.integrateMS << std::endl
+			<< "    last step " << last.candidatePairs << " pairs, " << last.contacts << " contacts, "
+			<< last.solverRows << " rows, " << last.awakeBodies << " awake" << std::endl
+			<< "    memory    scene " << after.residentMB - before.residentMB << "MB  resident "
+			<< after.residentMB << "MB  peak " << after.peakMB << "MB" << std::endl;
+
+		delete physics;
+		world.ClearAndErase();
+	}
+}
+
+int RunSceneBenchmarks(int argc, char** argv) {
+	SceneSettings settings;
+	if (!ParseSettings(argc, argv, settings)) {
+		return 1;
+	}
+	std::cout << "Scene benchmark: " << settings.steps << " steps, " << settings.threads << " threads, sleeping "
+		<< (settings.sleeping ? "on" : "off") << std::endl;
+
+	//Smallest first, so the process's peak memory is always from the scene that's just run
+	std::vector<int> bodyCounts = settings.bodyCounts;
+	std::sort(bodyCounts.begin(), bodyCounts.end());
+
+	for (int bodyCount : bodyCounts) {
+		for (const std::string& scene : settings.scenes) {
+			RunScene(settings, scene, bodyCount);
+		}
+	}
+	return 0;
+}
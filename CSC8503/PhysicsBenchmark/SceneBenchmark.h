@@ -0,0 +1,18 @@
+#pragma once
+
+/*
+
+Steps the whole physics system over generated scenes, like the sphere, cube
+and mixed grids and the rope bridge from TutorialGame, at a range of sizes,
+with nothing rendered. Each run reports how many steps and bodies it got
+through a second, how long its steps took at a few percentiles, and how much
+memory it used, so it can be run on a build box to catch regressions.
+
+Usage: PhysicsBenchmark scenes [--steps N] [--threads N] [--bodies 1000,10000,50000]
+	[--scenes sphere,cube,mixed,bridge] [--no-sleep] [--csv prefix]
+
+With --csv, the per-substep stats of each run are written to
+<prefix><scene>_<bodies>.csv
+
+*/
+int RunSceneBenchmarks(int argc, char** argv);
@@ -1,5 +1,6 @@
 #include "Keyboard.h"
 #include <string>
+#include <cstring>
 
 using namespace NCL;
 